@@ -0,0 +1,283 @@
+//
+// Component microbenchmarks for the interpreter pipeline.
+// Usage: drim_bench [--filter=SUBSTR] [--max-bytes=N] [--reps=N] [--json=FILE]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../include/Lexer.h"
+#include "../include/Parser.h"
+#include "../include/Scope.h"
+#include "../include/Value.h"
+#include "../include/Physics.h"
+#include "../include/DS.h"
+
+// Keeps the optimizer from deleting work whose result is unused
+template <typename T>
+inline void keep(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+struct BenchResult {
+    std::string name;
+    size_t reps;
+    double medianNs;  // per op
+    double p99Ns;     // per op
+    double mbPerSec;  // 0 when the benchmark has no byte size
+};
+
+struct BenchConfig {
+    std::string filter;
+    size_t maxBytes = 10u << 20;
+    size_t reps = 30;
+    std::string jsonPath;
+};
+
+static uint64_t nowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Times `body` (which performs `opsPerRep` operations over `bytesPerRep`
+// bytes) after a short warmup. Large inputs get fewer repetitions so a
+// single benchmark stays within roughly two seconds.
+static void runBench(const BenchConfig& config, std::vector<BenchResult>& results,
+                     const std::string& name, size_t opsPerRep, size_t bytesPerRep,
+                     const std::function<void()>& body) {
+    if (!config.filter.empty() && name.find(config.filter) == std::string::npos) return;
+
+    uint64_t warmStart = nowNs();
+    body();
+    uint64_t once = nowNs() - warmStart;
+    if (once < 50000000ULL) body();
+
+    size_t reps = config.reps;
+    if (once > 0) reps = std::min(reps, std::max<size_t>(3, (size_t)(2000000000ULL / once)));
+
+    std::vector<double> samples;
+    samples.reserve(reps);
+    for (size_t i = 0; i < reps; i++) {
+        uint64_t start = nowNs();
+        body();
+        samples.push_back((double)(nowNs() - start) / (double)opsPerRep);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult r;
+    r.name = name;
+    r.reps = reps;
+    r.medianNs = samples[samples.size() / 2];
+    size_t p99 = (size_t)((samples.size() * 99 + 99) / 100);
+    r.p99Ns = samples[std::min(samples.size() - 1, p99 > 0 ? p99 - 1 : 0)];
+    r.mbPerSec = bytesPerRep ? ((double)bytesPerRep / (r.medianNs * opsPerRep / 1e9)) / (1 << 20) : 0.0;
+    results.push_back(r);
+
+    char row[160];
+    std::snprintf(row, sizeof(row), "%-36s %6zu %14.1f %14.1f", name.c_str(), r.reps, r.medianNs, r.p99Ns);
+    std::cout << row;
+    if (r.mbPerSec > 0) {
+        std::snprintf(row, sizeof(row), " %10.1f", r.mbPerSec);
+        std::cout << row;
+    }
+    std::cout << std::endl;
+}
+
+// === Generated scripts ===
+
+// A mix of the statement shapes real scripts use, repeated with fresh names
+static std::string generateScript(size_t bytes) {
+    std::string out;
+    out.reserve(bytes + 256);
+    for (size_t i = 0; out.size() < bytes; i++) {
+        std::string n = std::to_string(i);
+        out += "v" + n + " = " + n + " * 3 + 7 % 5\n";
+        out += "if v" + n + " > 10 and v" + n + " < 100000 {\n    wake(\"big {v" + n + "}\")\n} else {\n    w" + n + " = v" + n + " - 1.5\n}\n";
+        out += "func f" + n + "(a, b) {\n    return a + b * 2\n}\n";
+        out += "drimming v" + n + " < 5 {\n    v" + n + " = v" + n + " + 1\n}\n";
+        out += "arr" + n + " = [1, 2, 3]\ns" + n + " = stack_create()  // comment\n";
+    }
+    return out;
+}
+
+static std::string sizeLabel(size_t bytes) {
+    if (bytes >= (1u << 20)) return std::to_string(bytes >> 20) + "MB";
+    return std::to_string(bytes >> 10) + "KB";
+}
+
+static void benchFrontEnd(const BenchConfig& config, std::vector<BenchResult>& results) {
+    const size_t sizes[] = {1u << 10, 10u << 10, 100u << 10, 1u << 20, 10u << 20, 100u << 20};
+    for (size_t target : sizes) {
+        if (target > config.maxBytes) break;
+        std::string source = generateScript(target);
+        std::string label = sizeLabel(target);
+
+        runBench(config, results, "lex/" + label, 1, source.size(), [&] {
+            Lexer lexer(source);
+            lexer.scanTokens();
+            keep(lexer.tokens.size());
+        });
+
+        Lexer lexer(source);
+        lexer.scanTokens();
+        runBench(config, results, "parse/" + label, 1, source.size(), [&] {
+            Parser parser(lexer.tokens);
+            auto commands = parser.parse();
+            keep(commands.size());
+        });
+    }
+}
+
+// === Scope ===
+
+static void benchScope(const BenchConfig& config, std::vector<BenchResult>& results) {
+    const size_t lookups = 100000;
+    for (int depth : {1, 4, 16, 64}) {
+        auto root = std::make_shared<Scope>();
+        Token name = {TOKEN_IDENTIFIER, "target", 1};
+        root->assign(name, Value(42LL));
+        for (int i = 0; i < 8; i++) {
+            root->assign({TOKEN_IDENTIFIER, "filler" + std::to_string(i), 1}, Value((long long)i));
+        }
+        std::shared_ptr<Scope> inner = root;
+        for (int d = 1; d < depth; d++) inner = std::make_shared<Scope>(inner);
+
+        runBench(config, results, "scope/get/depth" + std::to_string(depth), lookups, 0, [&] {
+            for (size_t i = 0; i < lookups; i++) keep(inner->get(name));
+        });
+        runBench(config, results, "scope/assign/depth" + std::to_string(depth), lookups, 0, [&] {
+            for (size_t i = 0; i < lookups; i++) inner->assign(name, Value((long long)i));
+        });
+    }
+}
+
+// === Value ===
+
+static void benchValue(const BenchConfig& config, std::vector<BenchResult>& results) {
+    const size_t ops = 100000;
+    std::string shortText = "drim";
+    std::string longText(1024, 'x');
+    auto collection = std::make_shared<std::vector<Value>>(16, Value(1LL));
+
+    struct Kind {
+        const char* name;
+        Value sample;
+        std::function<Value()> make;
+    };
+    std::vector<Kind> kinds = {
+        {"int", Value(7LL), [] { return Value(7LL); }},
+        {"float", Value(DrimFloat(7.5L)), [] { return Value(DrimFloat(7.5L)); }},
+        {"bool", Value(true), [] { return Value(true); }},
+        {"string16", Value(shortText), [&] { return Value(shortText); }},
+        {"string1k", Value(longText), [&] { return Value(longText); }},
+        {"collection", Value(collection), [&] { return Value(collection); }},
+    };
+
+    for (const Kind& kind : kinds) {
+        runBench(config, results, std::string("value/construct/") + kind.name, ops, 0, [&] {
+            for (size_t i = 0; i < ops; i++) keep(kind.make());
+        });
+        runBench(config, results, std::string("value/copy/") + kind.name, ops, 0, [&] {
+            for (size_t i = 0; i < ops; i++) {
+                Value copy = kind.sample;
+                keep(copy);
+            }
+        });
+    }
+}
+
+// === Builtin dispatch ===
+
+static void benchBuiltins(const BenchConfig& config, std::vector<BenchResult>& results) {
+    const size_t ops = 100000;
+    Value two[2] = {Value(10LL), Value(DrimFloat(9.8L))};
+    Value three[3] = {Value(DrimFloat(1.0L)), Value(DrimFloat(2.0L)), Value(DrimFloat(3.0L))};
+
+    // First and late entries of the name chain show the cost of the string compares
+    runBench(config, results, "physics/speed", ops, 0, [&] {
+        for (size_t i = 0; i < ops; i++) keep(execPhysics("speed", two, 2));
+    });
+    runBench(config, results, "physics/force", ops, 0, [&] {
+        for (size_t i = 0; i < ops; i++) keep(execPhysics("force", two, 2));
+    });
+    runBench(config, results, "physics/final_velocity", ops, 0, [&] {
+        for (size_t i = 0; i < ops; i++) keep(execPhysics("final_velocity", three, 3));
+    });
+
+    Value stack = execDS("stack_create", nullptr, 0);
+    Value pushArgs[2] = {stack, Value(5LL)};
+    runBench(config, results, "ds/stack_push+pop", ops, 0, [&] {
+        for (size_t i = 0; i < ops; i++) {
+            execDS("stack_push", pushArgs, 2);
+            keep(execDS("stack_pop", pushArgs, 1));
+        }
+    });
+    runBench(config, results, "ds/stack_size", ops, 0, [&] {
+        for (size_t i = 0; i < ops; i++) keep(execDS("stack_size", pushArgs, 1));
+    });
+}
+
+static void writeJson(const BenchConfig& config, const std::vector<BenchResult>& results) {
+    std::ofstream out(config.jsonPath);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not write '" << config.jsonPath << "'\n";
+        exit(1);
+    }
+    out << "{\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"reps\": " << r.reps
+            << ", \"median_ns\": " << r.medianNs << ", \"p99_ns\": " << r.p99Ns
+            << ", \"mb_per_s\": " << r.mbPerSec << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+static size_t parseBytes(const std::string& text) {
+    size_t value = std::strtoull(text.c_str(), nullptr, 10);
+    char unit = text.empty() ? '\0' : text.back();
+    if (unit == 'K' || unit == 'k') value <<= 10;
+    if (unit == 'M' || unit == 'm') value <<= 20;
+    return value;
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--filter=", 0) == 0) config.filter = arg.substr(9);
+        else if (arg.rfind("--max-bytes=", 0) == 0) config.maxBytes = parseBytes(arg.substr(12));
+        else if (arg.rfind("--reps=", 0) == 0) config.reps = std::max(1, std::atoi(arg.c_str() + 7));
+        else if (arg.rfind("--json=", 0) == 0) config.jsonPath = arg.substr(7);
+        else {
+            std::cout << "Usage: drim_bench [--filter=SUBSTR] [--max-bytes=N[K|M]] [--reps=N] [--json=FILE]\n"
+                      << "  Front-end sizes run from 1KB up to --max-bytes (default 10M, up to 100M).\n";
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    char header[160];
+    std::snprintf(header, sizeof(header), "%-36s %6s %14s %14s %10s", "benchmark", "reps", "median ns/op", "p99 ns/op", "MB/s");
+    std::cout << header << "\n";
+
+    std::vector<BenchResult> results;
+    benchFrontEnd(config, results);
+    benchScope(config, results);
+    benchValue(config, results);
+    benchBuiltins(config, results);
+
+    if (!config.jsonPath.empty()) writeJson(config, results);
+    return 0;
+}
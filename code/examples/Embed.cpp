@@ -0,0 +1,73 @@
+//
+// Embedding drim through libdrim: compile once, then run per request.
+//
+
+#include "Drim.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+static const char* SCRIPT = R"(
+price = base_price(item)
+if quantity > 10 {
+    price = price * 0.9
+}
+total = price * quantity
+wake("{item}: {total}")
+)";
+
+int main() {
+    std::string error;
+    auto program = drim::Program::compile(SCRIPT, &error);
+    if (!program) {
+        std::cerr << error;
+        return 1;
+    }
+
+    drim::Instance vm(program);
+    vm.bind("base_price", [](const std::vector<drim::Value>& args) {
+        return drim::Value(args[0].asString() == "bolt" ? 0.25 : 4.0);
+    });
+
+    // One request
+    vm.set("item", "bolt");
+    vm.set("quantity", 40);
+    drim::Result result = vm.run();
+    std::cout << result.output << "total from C++: " << (double)vm.get("total").asFloat() << "\n";
+
+    // Errors come back instead of ending the process
+    vm.reset();
+    vm.set("item", "nut");
+    result = vm.run(); // quantity is undefined after the reset
+    std::cout << "status " << result.status << ": " << result.error;
+
+    // A runtime error inside a function leaves the instance in its global
+    // scope: the function's locals are gone and the next run starts clean
+    auto failing = drim::Program::compile(R"(
+func fail(n) {
+    inner = n * 2
+    return missing + inner
+}
+runs = runs + 1
+fail(runs)
+)", &error);
+    drim::Instance guarded(failing);
+    guarded.set("runs", 0);
+    guarded.run();
+    result = guarded.run();
+    std::cout << "status " << result.status << " after 2 failing runs: runs = " << guarded.get("runs").asInt()
+              << ", inner is " << (guarded.get("inner").type() == drim::Value::OTHER ? "not global" : "LEAKED") << "\n";
+
+    // Per-request overhead: reset, set, run
+    const int requests = 100000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < requests; i++) {
+        vm.reset();
+        vm.set("item", "nut");
+        vm.set("quantity", i % 20);
+        vm.run();
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%.2f us per request\n", us / requests);
+    return 0;
+}
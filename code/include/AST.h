@@ -9,9 +9,11 @@
 #include "Value.h"
 #include <memory>
 #include <vector>
+#include <unordered_map>
 
 // Everything that "Does something" is a Stmt (Statement)
 struct Stmt {
+    int line = 0; // source line the statement starts on (0 = synthesized)
     virtual ~Stmt() = default; // Virtual destructor is required for casting to work
 };
 
@@ -22,7 +24,7 @@ struct Expr {
 
 // 2. The Data (Expressions) Represents raw text like "hello" or "123"
 struct LiteralExpr : Expr {
-    Value value; // Can now hold long long, long double, or string
+    Value value; // Can now hold long long, DrimFloat, or string
     LiteralExpr(Value v) : value(v) {}
 };
 
@@ -32,11 +34,15 @@ struct VariableExpr : Expr {
     VariableExpr(Token n) : name(n) {}
 };
 
+// What the type pass (Optimizer.h) proved both operands of a BinaryExpr hold
+enum OperandTypes { OPERANDS_UNKNOWN, OPERANDS_INT, OPERANDS_FLOAT };
+
 // Represents Math: 1 + 2, a * b
 struct BinaryExpr : Expr {
     std::shared_ptr<Expr> left;
     Token op; // The operator (+, -, *, /)
     std::shared_ptr<Expr> right;
+    OperandTypes operands = OPERANDS_UNKNOWN;
 
     BinaryExpr(std::shared_ptr<Expr> l, Token o, std::shared_ptr<Expr> r)
         : left(l), op(o), right(r) {}
@@ -57,6 +63,12 @@ struct CallExpr : Expr {
         : callee(c), paren(p), arguments(args) {}
 };
 
+// Represents: spawn func(args) -- evaluates to a task for await(t)
+struct SpawnExpr : Expr {
+    std::shared_ptr<CallExpr> call;
+    SpawnExpr(std::shared_ptr<CallExpr> c) : call(c) {}
+};
+
 struct ArrayLiteralExpr : Expr {
     std::vector<std::shared_ptr<Expr>> elements;
     ArrayLiteralExpr(std::vector<std::shared_ptr<Expr>> elems) : elements(elems) {}
@@ -68,6 +80,14 @@ struct ArrayAccessExpr : Expr {
     ArrayAccessExpr(Token n, std::shared_ptr<Expr> i) : name(n), index(i) {}
 };
 
+// name[start:end] -- either bound may be left out
+struct ArraySliceExpr : Expr {
+    Token name;
+    std::shared_ptr<Expr> start; // nullptr for 0
+    std::shared_ptr<Expr> end;   // nullptr for the array's size
+    ArraySliceExpr(Token n, std::shared_ptr<Expr> s, std::shared_ptr<Expr> e) : name(n), start(s), end(e) {}
+};
+
 struct ConvertExpr : Expr {
     std::shared_ptr<Expr> value;
     std::shared_ptr<Expr> mode;
@@ -80,6 +100,13 @@ struct InputStmt : Stmt {
     InputStmt(std::shared_ptr<Expr> t) : target(t) {}
 };
 
+// Command: drim(values[], n) -- reads up to n lines into an array
+struct ArrayInputStmt : Stmt {
+    Token name;
+    std::shared_ptr<Expr> count;
+    ArrayInputStmt(Token n, std::shared_ptr<Expr> c) : name(n), count(c) {}
+};
+
 // Command: wake("hello")
 struct PrintStmt : Stmt {
     std::shared_ptr<Expr> expression;
@@ -131,10 +158,26 @@ struct BlockStmt : Stmt {
     BlockStmt(std::vector<std::shared_ptr<Stmt>> stmts) : statements(stmts) {}
 };
 
+// Built by the parser for an if / else-if chain that compares one variable
+// with int or string constants: `if x == 1 {} else if x == 2 {} ...`.
+// The variable is read once and the arm is found by lookup instead of
+// testing every condition in turn.
+struct JumpTable {
+    Token subject;
+    std::vector<std::shared_ptr<Stmt>> arms; // each arm's then-branch
+    std::shared_ptr<Stmt> otherwise;         // the final else, may be nullptr
+    // Int constants close together index `dense` (arm, or -1) from `low`
+    long long low = 0;
+    std::vector<int> dense;
+    std::unordered_map<long long, int> ints;
+    std::unordered_map<std::string, int> strings;
+};
+
 struct IfStmt : Stmt {
     std::shared_ptr<Expr> condition;
     std::shared_ptr<Stmt> thenBranch;
     std::shared_ptr<Stmt> elseBranch; // Can be nullptr if there is no 'else'
+    std::shared_ptr<const JumpTable> jumpTable; // only on the head of a chain, if any
 
     IfStmt(std::shared_ptr<Expr> cond, std::shared_ptr<Stmt> thenB, std::shared_ptr<Stmt> elseB)
         : condition(cond), thenBranch(thenB), elseBranch(elseB) {}
@@ -144,10 +187,40 @@ struct IfStmt : Stmt {
 struct WhileStmt : Stmt {
     std::shared_ptr<Expr> condition;
     std::shared_ptr<Stmt> body;
+    int hoistedCount = 0; // HoistedExprs that cache values for this loop
     WhileStmt(std::shared_ptr<Expr> cond, std::shared_ptr<Stmt> b)
         : condition(cond), body(b) {}
 };
 
+// Put by the loop optimizer (Optimizer.h) in place of a pure expression
+// whose inputs the loop never assigns. It is evaluated where it is first
+// used in each run of the loop, so errors and skipped branches behave as
+// before, and its value is reused for the rest of that run.
+struct HoistedExpr : Expr {
+    std::shared_ptr<Expr> original;
+    const WhileStmt* loop;
+    int slot;          // index among loop->hoistedCount
+    bool callsBuiltin; // an embedding host could bind the name to something impure
+    HoistedExpr(std::shared_ptr<Expr> o, const WhileStmt* l, int s, bool c)
+        : original(o), loop(l), slot(s), callsBuiltin(c) {}
+};
+
+// Represents: drimming parallel i in 0..n reduce(+: total) { ... }
+//         or: drimming parallel v in arr { ... } / drimming parallel i, v in arr { ... }
+struct ParallelForStmt : Stmt {
+    Token indexVar;                   // empty lexeme when only the element is bound
+    Token valueVar;                   // empty lexeme for ranges
+    std::shared_ptr<Expr> rangeStart; // range form
+    std::shared_ptr<Expr> rangeEnd;   // exclusive
+    Token arrayName;                  // array form (empty lexeme for ranges)
+    std::vector<std::pair<TokenType, Token>> reductions; // operator, shared variable
+    std::shared_ptr<Stmt> body;
+
+    ParallelForStmt(Token i, Token v, std::shared_ptr<Expr> s, std::shared_ptr<Expr> e, Token arr,
+                    std::vector<std::pair<TokenType, Token>> r, std::shared_ptr<Stmt> b)
+        : indexVar(i), valueVar(v), rangeStart(s), rangeEnd(e), arrayName(arr), reductions(r), body(b) {}
+};
+
 // Represents: stopdrim (break)
 struct BreakStmt : Stmt {};
 
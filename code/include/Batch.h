@@ -0,0 +1,19 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include <string>
+
+struct BatchOptions {
+    std::string jobsPath;
+    size_t jobs = 0; // concurrent jobs, 0 = one per core
+};
+
+// drim --batch jobs.txt -j N: runs every job listed in jobs.txt (one
+// "script input output" per line, '-' for no input / discarded output) on
+// N threads in this process. Scripts are lexed and parsed once per distinct
+// content and shared read-only between jobs. Prints one status line per
+// job and returns 0 only if every job succeeded.
+int runBatch(const BatchOptions& options);
+
+#endif
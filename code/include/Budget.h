@@ -0,0 +1,52 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <atomic>
+#include <cstddef>
+
+// Execution limits behind --max-steps, --max-time and --max-mem, for running
+// untrusted scripts. A step is one loop iteration or one function call.
+// Interpreters spend steps from a local allowance (Interpreter::step) and
+// only come here when it runs out, so the steps are charged once per
+// allowance. The deadline does not wait for that: a watchdog thread raises
+// a flag that every step looks at, so a few slow steps cannot outrun it.
+// Memory is checked on every allocation. Hitting a limit is a runtime error.
+class Budget {
+public:
+    static void limitSteps(unsigned long long steps);
+    static void limitTime(double seconds);
+    // Needs the allocation hook in MemHook.cpp, so only the drim executable has it
+    static void limitMemory(size_t bytes);
+    static bool limited() { return active; }
+
+    // Set once --max-time has run out; the next step calls refuel()
+    static bool outOfTime() { return timeUp.load(std::memory_order_relaxed); }
+
+    // Checks the limits and returns the next allowance
+    static long long refuel();
+    // An interpreter finishing with `steps` of its allowance left hands them back
+    static void giveBack(long long steps);
+
+    // Heap accounting, fed by the allocation hook
+    static bool countingMemory() { return memoryLimit != 0; }
+    // Called before a block of `bytes` is allocated; ends the script if it
+    // would take the heap past the limit
+    static void allocating(size_t bytes) {
+        if (heapBytes.load(std::memory_order_relaxed) + (long long)bytes > (long long)memoryLimit) {
+            memoryExceeded(bytes);
+        }
+    }
+    static void allocated(size_t bytes) { heapBytes.fetch_add((long long)bytes, std::memory_order_relaxed); }
+    // Reports the limit as hit by a request for `requested` more bytes
+    [[noreturn]] static void memoryExceeded(size_t requested = 0);
+    static void freed(size_t bytes) { heapBytes.fetch_sub((long long)bytes, std::memory_order_relaxed); }
+
+private:
+    static bool active;
+    static size_t memoryLimit;
+    // Signed: blocks allocated before counting started may be freed later
+    static std::atomic<long long> heapBytes;
+    static std::atomic<bool> timeUp;
+};
+
+#endif
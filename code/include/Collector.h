@@ -0,0 +1,56 @@
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+#include "Value.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Cycle collector for stacks, queues and maps. Collections are reference
+// counted (shared_ptr), so one that holds itself, or two that hold each
+// other, are never freed. Every collection is registered here when created. Once
+// enough has been allocated since the last run, a trial deletion pass
+// subtracts the references collections hold to each other from their
+// use counts. Whatever is left with no outside reference, and is not
+// reachable from a collection that has one, is garbage and gets cleared.
+//
+// Each thread collects its own collections. Nothing is collected while
+// drimming parallel or spawned tasks may be touching collections from other
+// threads.
+class CycleCollector {
+public:
+    static CycleCollector& forThread();
+
+    void track(const std::shared_ptr<std::vector<Value>>& collection);
+    void track(const std::shared_ptr<Map>& map);
+    // Called as collections grow; runs a collection once enough has piled up
+    void noteAllocation(size_t bytes) {
+        allocated += bytes;
+        if (allocated >= trigger) collect();
+    }
+    // Returns the number of collections reclaimed
+    size_t collect();
+
+    // --gc-stats: print totals for every thread to stderr at exit
+    static void reportAtExit();
+    // Minimum allocation volume between runs (default 4 MiB)
+    static void setMinTrigger(size_t bytes);
+
+private:
+    // What a tracked object is, so the pass knows how to walk its values.
+    // Array buffers are not tracked: a pass picks up the ones it reaches
+    // from a collection, so cycles through arrays are found too.
+    enum class Kind { LIST, MAP, BUFFER };
+    struct Tracked {
+        std::weak_ptr<void> object;
+        Kind kind;
+    };
+
+    std::vector<Tracked> tracked;
+    size_t allocated = 0;
+    size_t trigger;
+
+    CycleCollector();
+};
+
+#endif
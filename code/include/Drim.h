@@ -0,0 +1,134 @@
+#ifndef DRIM_H
+#define DRIM_H
+
+// libdrim: run drim scripts from C++.
+//
+//     std::string error;
+//     auto program = drim::Program::compile(source, &error);   // once
+//     drim::Instance vm(program);                               // per thread
+//     vm.bind("lookup", [&](const std::vector<drim::Value>& args) { ... });
+//     vm.set("request_id", 42);
+//     drim::Result r = vm.run();
+//     if (!r.ok()) log(r.error);
+//     vm.reset();                                                // next request
+//
+// Nothing here exposes interpreter internals, so hosts only depend on this
+// header. A Program is immutable and may be shared by any number of threads;
+// an Instance must only be used by one thread at a time.
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace drim {
+
+// An int, float, string or bool crossing between drim and the host.
+// Stacks, queues and tasks show up as OTHER and cannot be passed in.
+class Value {
+public:
+    enum Type { INT, FLOAT, STRING, BOOL, OTHER };
+
+    Value() : kind(INT) {}
+    Value(int v) : kind(INT), i(v) {}
+    Value(long long v) : kind(INT), i(v) {}
+    Value(double v) : kind(FLOAT), f(v) {}
+    Value(long double v) : kind(FLOAT), f(v) {}
+    Value(const char* v) : kind(STRING), s(v) {}
+    Value(std::string v) : kind(STRING), s(std::move(v)) {}
+    Value(bool v) : kind(BOOL), b(v) {}
+
+    Type type() const { return kind; }
+    long long asInt() const { return kind == FLOAT ? (long long)f : i; }
+    long double asFloat() const { return kind == INT ? (long double)i : f; }
+    bool asBool() const { return b; }
+    // The text for STRING and OTHER values
+    const std::string& asString() const { return s; }
+
+    static Value other(std::string description) {
+        Value v(std::move(description));
+        v.kind = OTHER;
+        return v;
+    }
+
+private:
+    Type kind;
+    long long i = 0;
+    long double f = 0.0L;
+    std::string s;
+    bool b = false;
+};
+
+// A host function callable from drim as name(args...)
+using Function = std::function<Value(const std::vector<Value>& args)>;
+
+// Receives a run's output as it is produced: wake/wakef text, or error
+// messages when isError is set
+using OutputSink = std::function<void(const std::string& text, bool isError)>;
+
+struct Result {
+    int status = 0;      // 0 on success, otherwise what `drim` would exit with
+    std::string error;   // the error message(s) when status != 0
+    std::string output;  // everything the run printed with wake/wakef
+                         // (both stay empty when the output is streamed)
+
+    bool ok() const { return status == 0; }
+};
+
+class Program {
+public:
+    // Lexes and parses `source`. Returns nullptr (and the syntax error in
+    // *error, if given) when it does not parse.
+    static std::shared_ptr<const Program> compile(const std::string& source, std::string* error = nullptr);
+    static std::shared_ptr<const Program> compileFile(const std::string& path, std::string* error = nullptr);
+
+    ~Program();
+
+private:
+    struct Impl;
+    Program();
+    std::unique_ptr<Impl> state;
+    friend class Instance;
+};
+
+class Instance {
+public:
+    explicit Instance(std::shared_ptr<const Program> program);
+    ~Instance();
+    Instance(const Instance&) = delete;
+    Instance& operator=(const Instance&) = delete;
+
+    // Defines a global the script can read (and overwrite)
+    void set(const std::string& name, const Value& value);
+    // Reads a global after a run; OTHER if it does not exist
+    Value get(const std::string& name) const;
+
+    // Makes `fn` callable from the script. Script functions with the same
+    // name win; host functions win over the builtins.
+    void bind(const std::string& name, Function fn);
+
+    // Lines served to drim() during the next runs
+    void setInput(const std::string& text);
+
+    // Sends the output of the next runs to `sink` while they run, instead
+    // of collecting it in the Result. Text is passed on in chunks: once a
+    // few KiB pile up, at a newline when some time has passed since the
+    // last chunk, before every error message, and when the run ends.
+    void streamOutput(OutputSink sink);
+
+    // Runs the program against the current globals. Runtime errors end the
+    // run and come back in the Result; they never terminate the host.
+    Result run();
+
+    // Forgets globals and script-defined functions, keeping the program,
+    // bound functions and input. Cheap enough to call between requests.
+    void reset();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> state;
+};
+
+}
+
+#endif
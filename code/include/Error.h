@@ -0,0 +1,18 @@
+#ifndef ERROR_H
+#define ERROR_H
+
+// Thrown by drimExit on threads that run a --batch job. The error message
+// has already been written to std::cerr by then.
+struct ScriptExit {
+    int status;
+};
+
+// Ends the script after an error. Exits the process, unless this thread
+// runs a job that must fail alone (see setThrowOnExit).
+[[noreturn]] void drimExit(int status);
+
+// While on, drimExit on this thread throws ScriptExit instead of exiting
+void setThrowOnExit(bool on);
+bool throwsOnExit();
+
+#endif
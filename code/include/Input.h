@@ -0,0 +1,49 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "Value.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <memory>
+
+// Buffered stdin used by drim(). A regular file on stdin is mapped whole;
+// pipes and terminals are read in large chunks. Lines handed out stay valid
+// until the next call to readLine.
+class InputBuffer {
+public:
+    static InputBuffer& instance();
+
+    // Returns false once stdin is exhausted. The trailing '\n' is stripped.
+    bool readLine(std::string_view& line);
+
+    // Serves input from the given text instead of stdin, starting over from
+    // its first line (drim --bench replays a recorded input file per run)
+    void replay(const std::string& text);
+
+    // --batch: an input that serves `text`, and a per-thread override that
+    // makes instance() return it on the calling thread (nullptr to reset)
+    static std::unique_ptr<InputBuffer> fromText(const std::string& text);
+    static void useForThread(InputBuffer* own);
+    static InputBuffer* usedForThread();
+
+private:
+    const char* mapped = nullptr;   // whole-file view when stdin is mmap'd
+    size_t mappedSize = 0;
+    std::vector<char> chunk;        // read(2) buffer otherwise
+    std::string replayed;           // text set by replay()
+    size_t begin = 0;
+    size_t end = 0;
+    bool eof = false;
+    bool opened = false;
+
+    InputBuffer() = default;
+    void open();
+    bool fill();
+};
+
+// Turns one line of user input into an int, a float or a string
+Value parseInput(std::string_view text);
+
+#endif
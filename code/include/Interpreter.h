@@ -8,7 +8,14 @@
 #include "AST.h"
 #include "Value.h"
 #include "Scope.h"
+#include "Jit.h"
+#include "Profiler.h"
+#include "SampleProfiler.h"
+#include "Tracer.h"
+#include "Budget.h"
+#include "Tasks.h"
 #include <vector>
+#include <deque>
 #include <string>
 #include <memory>
 #include <map>
@@ -19,13 +26,92 @@ struct ReturnValue {
     ReturnValue(Value v) : value(v) {}
 };
 
+// Pops a call's arguments off the argument stack when the call finishes,
+// including when it unwinds through an exception.
+struct ArgFrame {
+    std::vector<Value>& stack;
+    size_t base;
+    bool active = true;
+
+    ArgFrame(std::vector<Value>& s) : stack(s), base(s.size()) {}
+    ~ArgFrame() { release(); }
+    void release() {
+        if (active) stack.resize(base);
+        active = false;
+    }
+};
+
+// Makes `inner` the current scope until it goes out of scope, including
+// when a runtime error, break or continue unwinds through it, so the
+// interpreter is back in the caller's scope afterwards.
+struct ScopeSwap {
+    std::shared_ptr<Scope>& current;
+    std::shared_ptr<Scope> saved;
+
+    ScopeSwap(std::shared_ptr<Scope>& c, std::shared_ptr<Scope> inner) : current(c), saved(std::move(c)) {
+        current = std::move(inner);
+    }
+    ~ScopeSwap() { current = std::move(saved); }
+};
+
 class Interpreter {
     std::shared_ptr<Scope> scope;
+    // Reused across calls so argument passing does not allocate per call
+    std::vector<Value> argStack;
+    // Only set when running with --jit
+    std::unique_ptr<Jit> jit;
+    // Only set when running with --profile
+    Profiler* profiler = nullptr;
+    // Only set when running with --sample-profile
+    SampleProfiler* sampler = nullptr;
+    // Only set when running with --trace; every interpreter created while it
+    // runs records into it
+    Tracer* tracer = nullptr;
+    // Only set when embedded through libdrim with bound host functions
+    HostCall hostCall;
+    // Only set on the interpreters running a drimming parallel loop's body
+    ParallelWorker* worker = nullptr;
+    // Set on the interpreters running a spawned task
+    bool inTask = false;
+    // Steps left before the Budget has to be asked for more
+    long long fuel = 0;
+    // Values of HoistedExprs for each running loop that has them: a frame is
+    // the loop and where its slots start. A deque so pushing a frame never
+    // moves the values read() has handed out.
+    std::deque<Value> hoistedValues;
+    std::vector<char> hoistedReady;
+    std::vector<std::pair<const WhileStmt*, size_t>> hoistFrames;
+
+    Interpreter(std::shared_ptr<Scope> workerScope, ParallelWorker* worker); // Parallel.cpp
+    void execute(const std::shared_ptr<Stmt>& cmd);
+    // Spends one step (a loop iteration or a call) of the execution budget
+    void step() {
+        if (--fuel < 0 || Budget::outOfTime()) fuel = Budget::refuel() - 1;
+    }
+    void executeParallel(const ParallelForStmt& loop); // Parallel.cpp
+    Value spawnTask(const SpawnExpr& spawn); // Tasks.cpp
+    // Like evaluate, but variables, array elements and constant literals
+    // come back as a reference to where they are stored instead of a copy.
+    // Anything else is computed into `scratch`.
+    const Value& read(const std::shared_ptr<Expr>& expr, Value& scratch);
+    Value typedBinary(const BinaryExpr& bin);
+    // The loop-invariant value, computed on its first use in this run of the loop
+    const Value& readHoisted(const HoistedExpr& hoisted, Value& scratch);
 
 public:
+    static Value runTask(Task& task); // Tasks.cpp
     Interpreter(); 
-    void interpret(std::vector<std::shared_ptr<Stmt>> commands);
-    Value evaluate(std::shared_ptr<Expr> expr);
+    ~Interpreter() { Budget::giveBack(fuel); }
+    void enableJit(int threshold);
+    void enableProfiler(Profiler* p) { profiler = p; }
+    void enableSampler(SampleProfiler* s) { sampler = s; }
+    void setHostCall(HostCall call) { hostCall = std::move(call); }
+    // The global scope (between runs, the current scope is the global one)
+    Scope& globals() { return *scope; }
+    // Drops every variable, array and function so the next run starts fresh
+    void reset();
+    void interpret(const std::vector<std::shared_ptr<Stmt>>& commands);
+    Value evaluate(const std::shared_ptr<Expr>& expr);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "AST.h"
+#include "Scope.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Baseline JIT for hot drimming loops and user functions (Linux x86-64 only).
+// The numeric subset of the language is compiled: int variables, locals and
+// literals, arithmetic, bitwise ops, comparisons, and/or, if/else, nested
+// loops and calls to other compilable user functions. Floats are compiled
+// too when they are doubles (DRIM_DOUBLE_FLOATS), except '%' and '^'.
+// Every variable keeps the kind it had when the region was compiled, so
+// types cannot change inside compiled code; the type guards run when
+// control enters it and fall back to the interpreter.
+class Jit {
+public:
+    struct Region;
+
+    explicit Jit(int threshold);
+    ~Jit();
+
+    static bool supported();
+
+    // Per-loop bookkeeping, fetched once before the loop starts
+    Region* loopEntry(const WhileStmt* loop);
+
+    // Called at the top of every iteration. Returns true if the rest of the
+    // loop was run natively (the interpreter should leave the loop).
+    bool tryRunLoop(Region* region, Scope& scope);
+
+    // Returns true and sets result if the call was run natively.
+    bool tryCall(const FunctionStmt* func, Scope& scope, const Value* args, size_t count, Value& result);
+
+private:
+    int threshold;
+    std::unordered_map<const Stmt*, std::unique_ptr<Region>> regions;
+    std::vector<std::pair<void*, size_t>> codePages;
+
+    bool compileLoop(Region& region, Scope& scope);
+    bool compileFunction(Region& region, Scope& scope);
+    bool depsValid(const Region& region, Scope& scope, std::vector<const Region*>& seen);
+    bool localsFree(Region& region, Scope& scope, const std::vector<const Region*>& reachable);
+    Region& regionFor(const Stmt* stmt);
+    void* install(const std::vector<uint8_t>& code);
+
+    friend struct JitCompiler;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef MAP_H
+#define MAP_H
+
+#include "Value.h"
+#include <cstdint>
+#include <vector>
+
+// Hash map behind the map_ builtins. Keys are ints or strings (a float key
+// holding a whole number is the int key, as 2.0 == 2 in drim).
+// Entries are kept in insertion order in one vector, and an open-addressing
+// index (linear probing, power-of-two capacity) maps hashes to them. An
+// index slot is 8 bytes, the entry's position and the high 32 bits of its
+// hash (the low bits pick the slot), so probing only touches an entry
+// whose hash matches. Removing leaves a dead
+// entry and a tombstone in the index until the next rebuild.
+class Map {
+public:
+    // Entry positions in the index are int32_t
+    static const size_t MAX_KEYS = INT32_MAX;
+
+    size_t size() const { return count; }
+    // Makes room for `expected` keys (at most MAX_KEYS) so adding them never
+    // rebuilds. Only a hint: if malloc cannot supply the room, nothing
+    // changes (a --max-mem limit still stops the script).
+    void reserve(size_t expected);
+
+    // The value stored under `key`, or nullptr. Keys must be normalized.
+    const Value* find(const Value& key) const;
+    void set(const Value& key, Value value);
+    bool remove(const Value& key);
+    // Live keys in the order they were first set
+    std::vector<Value> keys() const;
+    // Calls visit(value) for every live entry; the cycle collector walks maps with it
+    template <typename Visit> void forEachValue(Visit visit) const {
+        for (const Entry& entry : entries) {
+            if (entry.live) visit(entry.value);
+        }
+    }
+
+    // The key `key` is stored under; false for values that cannot be keys
+    static bool normalizeKey(const Value& key, Value& normalized);
+
+private:
+    static const int32_t EMPTY = -1;
+    static const int32_t DELETED = -2;
+
+    struct Slot {
+        int32_t entry = EMPTY;
+        uint32_t tag = 0; // high 32 bits of the hash; the low bits already chose the slot
+    };
+    struct Entry {
+        uint64_t hash;
+        Value key;
+        Value value;
+        bool live;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<Slot> index;
+    size_t count = 0;
+
+    static uint64_t hashOf(const Value& key);
+    // Index slot of `key`, or of the empty slot ending its probe sequence
+    size_t probe(const Value& key, uint64_t hash) const;
+    // Drops dead entries and re-indexes into at least `capacity` slots
+    void rebuild(size_t capacity);
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+struct AnyValue;
+struct ArrayBuffer;
+
+// What a heap block was allocated for. The interpreter sets the category
+// for the calling thread around the code that builds each kind of data
+// (MemTag); anything allocated outside such code counts as MEM_OTHER.
+enum MemCategory {
+    MEM_OTHER,
+    MEM_AST,
+    MEM_TOKENS,
+    MEM_SCOPES,
+    MEM_STRINGS, // strings and everything else scalar values allocate
+    MEM_ARRAYS,
+    MEM_COLLECTIONS,
+    MEM_CATEGORIES
+};
+
+// --mem-stats: live and peak heap bytes and allocation counts per category,
+// fed by the operator new/delete replacement in MemHook.cpp (linked into
+// the drim executable only), plus the largest live arrays and collections
+// with the line that created them.
+class MemStats {
+public:
+    static bool enabled() { return on.load(std::memory_order_relaxed); }
+    // Starts counting. With intervalSeconds > 0, a one-line summary is also
+    // printed to stderr that often while the script runs.
+    static void enable(int intervalSeconds);
+    // Prints the summary and top arrays/collections to stderr, once. Also
+    // runs at exit, for scripts that stop with an error.
+    static void report();
+
+    // The allocation hook
+    static void allocated(void* block, size_t size);
+    static void freed(void* block);
+
+    // The line of the statement running on this thread, for creation sites
+    static void setLine(int line);
+    static void trackArray(const ArrayBuffer* buffer);
+    static void untrackArray(const ArrayBuffer* buffer);
+    static void trackCollection(const std::shared_ptr<std::vector<AnyValue>>& collection);
+
+private:
+    static std::atomic<bool> on;
+};
+
+// Charges what the calling thread allocates to `category` until it goes
+// out of scope. Free when --mem-stats is off.
+struct MemTag {
+    MemCategory saved;
+    bool active;
+    explicit MemTag(MemCategory category);
+    ~MemTag();
+    MemTag(const MemTag&) = delete;
+    MemTag& operator=(const MemTag&) = delete;
+};
+
+namespace memstats_detail {
+extern thread_local MemCategory current;
+}
+
+inline MemTag::MemTag(MemCategory category) : saved(MEM_OTHER), active(MemStats::enabled()) {
+    if (!active) return;
+    saved = memstats_detail::current;
+    memstats_detail::current = category;
+}
+
+inline MemTag::~MemTag() {
+    if (active) memstats_detail::current = saved;
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "AST.h"
+#include <memory>
+#include <vector>
+
+// Loop-invariant code motion. In every drimming loop, replaces each
+// largest pure subexpression whose inputs nothing in the loop assigns
+// (including the functions the loop calls) with a HoistedExpr, so it is
+// computed once per run of the loop instead of once per iteration.
+// Builtins count as pure only if they are in the purity table (physics,
+// array_size); stack/queue operations, await and user functions never do.
+void hoistLoopInvariants(std::vector<std::shared_ptr<Stmt>>& program);
+
+// Flow-sensitive type inference. Tracks which names provably hold an int,
+// a float or an array of either, starting from literals, builtin results
+// and array literals, and forgetting a name whenever input, a called
+// function or a parallel loop may change it. Marks each BinaryExpr whose
+// operands are both proven int or both proven float, so the interpreter
+// can skip its type dispatch there.
+void inferTypes(std::vector<std::shared_ptr<Stmt>>& program);
+
+#endif
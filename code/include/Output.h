@@ -0,0 +1,65 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <streambuf>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Buffered stdout used by wake/wakef. It is installed as std::cout's stream
+// buffer so every writer shares it, and std::cerr (tied to std::cout) still
+// flushes pending output before an error message.
+// Flush policy: when the buffer fills, before drim() blocks on input, at exit,
+// and after every newline in line-buffered mode (--line-buffered, or when
+// stdout is a terminal).
+class OutputBuffer : public std::streambuf {
+public:
+    static OutputBuffer& instance();
+
+    void install(bool lineBuffered);
+    void flush();
+    void write(const char* data, size_t size);
+    // Drops everything written while set (drim --bench sends wake here)
+    void setDiscard(bool discard);
+    // Called around stretches where other threads may print (drimming
+    // parallel, spawned tasks); OutputGuard only locks inside them
+    static void enterConcurrent();
+    static void leaveConcurrent();
+    // True while other threads may be running drim code
+    static bool concurrent();
+    // --batch: while set, wake output from the calling thread is appended to
+    // `out` and std::cerr text to `err` instead of the process's streams
+    static void captureThread(std::string* out, std::string* err);
+    static void capturedThread(std::string*& out, std::string*& err);
+    // With a drain set, the calling thread's captured text is passed to it
+    // after every write (flush = false) and on every flush (flush = true);
+    // it may hand the text on and clear it
+    using Drain = std::function<void(std::string& text, bool isError, bool flush)>;
+    static void drainThread(const Drain* drain);
+    static const Drain* drainedThread();
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int sync() override;
+
+private:
+    static const size_t CAPACITY = 1 << 16;
+    char buffer[CAPACITY];
+    size_t used = 0;
+    bool lineBuffered = false;
+    bool discard = false;
+
+    OutputBuffer() = default;
+    void writeOut(const char* data, size_t size);
+};
+
+// Held while writing one wake/type line so lines from different threads
+// come out whole. Free when only the main thread is running.
+struct OutputGuard {
+    std::unique_lock<std::mutex> lock;
+    OutputGuard();
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "Value.h"
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+struct ParallelRegion;
+
+// One thread's view of a running drimming parallel loop. Its scope is
+// isolated (see Scope::isolate), so the thread can read shared variables
+// but only write its own locals, its reduction partials and distinct
+// elements of shared arrays.
+struct ParallelWorker {
+    ParallelRegion* region;
+    size_t id;
+    // Stacks, queues and maps created by this worker; only these may be mutated
+    std::unordered_set<const void*> ownCollections;
+    // Claim table of the shared array written last, to skip the lookup
+    const std::vector<Value>* lastArray = nullptr;
+    std::atomic<unsigned long long>* lastClaims = nullptr;
+
+    ParallelWorker(ParallelRegion* r, size_t i) : region(r), id(i) {}
+};
+
+// stack_/queue_ builtins called from a worker
+Value parallelDS(ParallelWorker& worker, const std::string& name, const Value* args, size_t count);
+
+#endif
@@ -46,10 +46,13 @@ private:
 
 
     // --- Statement Parsing ---
-    std::shared_ptr<Stmt> statement();     // Decides if it's IF, PRINT, or ASSIGN
+    std::shared_ptr<Stmt> statement();     // Tags the parsed statement with its line
+    std::shared_ptr<Stmt> parseStatement(); // Decides if it's IF, PRINT, or ASSIGN
     std::shared_ptr<Stmt> ifStatement();   // Parses if-else
+    void buildJumpTable(IfStmt& head);     // else-if chains on one variable
     std::vector<std::shared_ptr<Stmt>> block(); // Parses { ... }
     std::shared_ptr<Stmt> whileStatement();   // Parses drimming loops
+    std::shared_ptr<Stmt> parallelForStatement(); // Parses drimming parallel loops
     
     std::shared_ptr<Stmt> functionDeclaration(); // Parses func name(params){body}
     std::shared_ptr<Stmt> returnStatement(); // Parses return expression
@@ -0,0 +1,87 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct FunctionStmt;
+
+// Instrumenting profiler behind --profile. The interpreter only touches it
+// through the guards below, and only when profiling is on.
+// Lines get exclusive time (nested statements and calls are subtracted);
+// functions get both inclusive and exclusive time.
+class Profiler {
+public:
+    static Profiler& start(const std::string& jsonPath, const std::string& source);
+
+    static uint64_t now() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void enterLine(int line);
+    void leaveLine();
+    void enterCall(const FunctionStmt* func);
+    void leaveCall();
+
+    void report();
+
+    struct LineGuard {
+        Profiler& p;
+        bool active;
+        LineGuard(Profiler& prof, int line) : p(prof), active(line > 0) {
+            if (active) p.enterLine(line);
+        }
+        ~LineGuard() {
+            if (active) p.leaveLine();
+        }
+    };
+
+    struct CallGuard {
+        Profiler* p;
+        CallGuard(Profiler* prof, const FunctionStmt* func) : p(prof) {
+            if (p) p->enterCall(func);
+        }
+        ~CallGuard() {
+            if (p) p->leaveCall();
+        }
+    };
+
+private:
+    struct LineStats {
+        uint64_t count = 0;
+        uint64_t selfNs = 0;
+    };
+    struct FuncStats {
+        std::string name; // copied, the AST is gone by the time report() runs
+        int line = 0;
+        uint64_t calls = 0;
+        uint64_t inclusiveNs = 0;
+        uint64_t exclusiveNs = 0;
+        int active = 0; // recursion depth, so inclusive time is only added once
+    };
+    struct LineFrame {
+        uint64_t start;
+        uint64_t childNs;
+        int line;
+    };
+    struct CallFrame {
+        uint64_t start;
+        uint64_t childNs;
+        FuncStats* stats;
+    };
+
+    std::string jsonPath;
+    std::vector<std::string> sourceLines;
+    std::vector<LineStats> lines; // indexed by line number
+    std::unordered_map<const FunctionStmt*, FuncStats> functions;
+    std::vector<LineFrame> lineStack;
+    std::vector<CallFrame> callStack;
+
+    Profiler(const std::string& path, const std::string& source);
+};
+
+#endif
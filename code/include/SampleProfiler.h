@@ -0,0 +1,91 @@
+#ifndef SAMPLE_PROFILER_H
+#define SAMPLE_PROFILER_H
+
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <string>
+
+struct FunctionStmt;
+
+// Sampling profiler behind --sample-profile=HZ. A SIGPROF timer interrupts
+// the interpreter, and the handler copies the shadow stack of drim frames
+// (function + current line) into preallocated tables. At exit the stacks
+// are written in the folded format flamegraph tools read.
+// The timer counts CPU time of the whole process, and the kernel sends the
+// signal to any thread that does not block it. Only the thread that called
+// start() has the shadow stack, so pool and task workers block SIGPROF and
+// the handler ignores any other thread: samples taken while the main thread
+// waits for workers land on the line it waits at.
+class SampleProfiler {
+public:
+    static bool supported();
+    static SampleProfiler& start(int hz, const std::string& outPath);
+    // Called by worker threads as they start
+    static void blockSignal();
+
+    // Shadow stack, maintained by the interpreter on call and return.
+    // Frames are written before depth is published, so the handler never
+    // sees a half-built frame.
+    void push(const FunctionStmt* func) {
+        int d = depth;
+        if (d < MAX_DEPTH) {
+            frames[d].func = func;
+            frames[d].line = 0;
+        }
+        std::atomic_signal_fence(std::memory_order_release);
+        depth = d + 1;
+    }
+    void pop() { depth = depth - 1; }
+    void setLine(int line) {
+        if (depth <= MAX_DEPTH) frames[depth - 1].line = line;
+    }
+
+    // Stops the timer and writes the folded stacks; only the first call does anything
+    void finish();
+
+    struct CallGuard {
+        SampleProfiler* p;
+        CallGuard(SampleProfiler* prof, const FunctionStmt* func) : p(prof) {
+            if (p) p->push(func);
+        }
+        ~CallGuard() {
+            if (p) p->pop();
+        }
+    };
+
+private:
+    static const int MAX_DEPTH = 128;
+    static const size_t BUCKETS = 1 << 14;
+    static const size_t POOL = 1 << 18;
+
+    struct Frame {
+        const FunctionStmt* func; // nullptr is the top level script
+        int line;
+    };
+    struct Bucket {
+        uint64_t hash;
+        uint64_t count;
+        uint32_t depth;
+        uint32_t offset;
+    };
+
+    Frame frames[MAX_DEPTH];
+    volatile sig_atomic_t depth = 1;
+
+    // Aggregated samples; all storage is allocated up front
+    Bucket* buckets;
+    Frame* pool;
+    size_t poolUsed = 0;
+    uint64_t dropped = 0;
+
+    std::string outPath;
+    int hz;
+    bool finished = false;
+
+    SampleProfiler(int hz, const std::string& outPath);
+    static void onSignal(int);
+    void record();
+};
+
+#endif
@@ -3,212 +3,359 @@
 
 #include "Value.h"
 #include "Token.h"
-#include <map>
+#include "Error.h"
+#include "SymbolTable.h"
 #include <string>
 #include <memory>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 
 struct FunctionStmt;
+struct ParallelWorker;
+
+// Defined in Parallel.cpp. Records that `iteration` of a drimming parallel
+// loop writes arr[index] and fails if a different iteration already did.
+void claimParallelWrite(ParallelWorker* worker, unsigned long long iteration,
+                        const std::string& name, std::vector<Value>& arr, int index);
 
 //Manages variable storage and lookups for nested scopes.
 
 class Scope {
     std::shared_ptr<Scope> enclosing; // Parent scope
-    std::map<std::string, Value> values;
-    std::map<std::string, std::vector<Value>> arrays;
-    std::map<std::string, std::string> arrayElementTypes;
-    // Map for user-defined func
-    std::map<std::string, std::shared_ptr<FunctionStmt>> functions;
+    // Variables, arrays and user-defined functions, one entry per name
+    SymbolTable symbols;
+
+    // drimming parallel: set on a worker's private scope. Children inherit
+    // inParallel, so scopes outside parallel loops skip the checks entirely.
+    ParallelWorker* parallel = nullptr;
+    unsigned long long parallelIteration = 0;
+    bool inParallel = false;
 
-    std::string inferValueTypeName(const Value& value) {
+    static std::string inferValueTypeName(const Value& value) {
         if (std::holds_alternative<long long>(value.data)) return "int";
-        if (std::holds_alternative<long double>(value.data)) return "float";
+        if (std::holds_alternative<DrimFloat>(value.data)) return "float";
         if (std::holds_alternative<std::string>(value.data)) return "string";
         if (std::holds_alternative<bool>(value.data)) return "bool";
+        if (std::holds_alternative<Array>(value.data)) return "array";
         return "unknown";
     }
 
-    Scope* findArrayOwner(const std::string& name) {
-        if (arrays.count(name)) return this;
-        if (enclosing) return enclosing->findArrayOwner(name);
+    static bool isArray(const Value& value) { return std::holds_alternative<Array>(value.data); }
+
+    // Where `name` is stored, searching outward, or nullptr; one table
+    // probe per scope on the way
+    Value* findSlot(const std::string& name, Scope** owner = nullptr) {
+        size_t hash = SymbolTable::hashOf(name);
+        for (Scope* current = this; current; current = current->enclosing.get()) {
+            Symbol* symbol = current->symbols.find(name, hash);
+            if (symbol && symbol->hasValue) {
+                if (owner) *owner = current;
+                return &symbol->value;
+            }
+        }
         return nullptr;
     }
 
-    Scope* findValueOwner(const std::string& name) {
-        if (values.count(name)) return this;
-        if (enclosing) return enclosing->findValueOwner(name);
-        return nullptr;
+    // The variable `name` in this scope, created (as false) if missing
+    Value& localSlot(const std::string& name) {
+        Symbol& symbol = symbols.insert(name, SymbolTable::hashOf(name));
+        symbol.hasValue = true;
+        return symbol.value;
     }
 
+    // Arrays created on first element write live here. Inside a parallel
+    // worker that is the worker's private scope, not the shared globals.
     Scope* rootScope() {
         Scope* current = this;
-        while (current->enclosing) {
+        while (current->enclosing && !current->parallel) {
             current = current->enclosing.get();
         }
         return current;
     }
 
+    // The worker scope we cross to reach `owner`, or nullptr if `owner` is
+    // private to this worker (or we are not in a parallel loop at all)
+    Scope* sharedBoundary(Scope* owner) {
+        for (Scope* current = this; current; current = current->enclosing.get()) {
+            if (current == owner) return nullptr;
+            if (current->parallel) return current;
+        }
+        return nullptr;
+    }
+
+    // The array `name` for writing elements, created empty in rootScope()
+    // if it does not exist yet
+    Array& writableArray(const Token& name, Scope*& owner) {
+        Value* slot = findSlot(name.lexeme, &owner);
+        if (!slot) {
+            owner = rootScope();
+            slot = &(owner->localSlot(name.lexeme) = Value(Array{std::make_shared<ArrayBuffer>()}));
+        }
+        if (!isArray(*slot)) {
+            std::cerr << "Runtime Error: '" << name.lexeme << "' is a variable, not an array\n";
+            drimExit(1);
+        }
+        return std::get<Array>(slot->data);
+    }
+
+    static void checkElementType(const Token& name, Array& arr, const Value& value) {
+        std::string currentType = inferValueTypeName(value);
+        std::string& expectedType = arr.buffer->elementType;
+        if (expectedType.empty()) {
+            expectedType = currentType;
+        } else if (expectedType != currentType) {
+            std::cerr << "Runtime Error: Array value type is '" << currentType
+                      << "', must be matched with '" << expectedType << "' for array '"
+                      << name.lexeme << "'\n";
+            drimExit(1);
+        }
+    }
+
 public:
     Scope() : enclosing(nullptr) {}
-    Scope(std::shared_ptr<Scope> enclosing) : enclosing(enclosing) {}
+    Scope(std::shared_ptr<Scope> enclosing)
+        : enclosing(enclosing), inParallel(enclosing && enclosing->inParallel) {}
+
+    // Turns this scope into a drimming parallel worker scope
+    void isolate(ParallelWorker* worker) {
+        parallel = worker;
+        inParallel = true;
+    }
+
+    void setParallelIteration(unsigned long long iteration) { parallelIteration = iteration; }
 
 
     // Updates an existing variable or defines a new one in the current scope
     // if it doesn't exist in the chain.
 
     bool contains(const std::string& name) {
-        if (values.count(name)) return true;
-        if (enclosing) return enclosing->contains(name);
-        return false;
+        return findSlot(name) != nullptr;
     }
 
     void assign(const Token& name, Value value) {
-        if (hasArray(name.lexeme)) {
+        Scope* owner = nullptr;
+        Value* slot = findSlot(name.lexeme, &owner);
+        if (!slot) {
+            localSlot(name.lexeme) = std::move(value);
+            return;
+        }
+        // A name stays an array or a scalar for good
+        if (isArray(*slot) && !isArray(value)) {
             std::cerr << "Runtime Error: '" << name.lexeme << "' is an array, cannot assign scalar value\n";
-            exit(1);
+            drimExit(1);
         }
-        if (values.count(name.lexeme)) {
-            values[name.lexeme] = value;
-        } else if (enclosing && enclosing->contains(name.lexeme)) {
-            enclosing->assign(name, value);
-        } else {
-            values[name.lexeme] = value;
+        if (!isArray(*slot) && isArray(value)) {
+            std::cerr << "Runtime Error: '" << name.lexeme << "' already exists as a variable\n";
+            drimExit(1);
         }
-    }
-
-    // Looks up a variable in the current scope or parent scopes.
-
-    Value get(const Token& name) {
-        if (values.count(name.lexeme)) {
-            return values[name.lexeme];
+        if (inParallel && sharedBoundary(owner)) {
+            if (isArray(value)) {
+                std::cerr << "Runtime Error: Cannot replace shared array '" << name.lexeme
+                          << "' inside drimming parallel\n";
+            } else {
+                std::cerr << "Runtime Error: Cannot assign shared variable '" << name.lexeme
+                          << "' inside drimming parallel (use a reduce(...) clause or a local)\n";
+            }
+            drimExit(1);
         }
+        *slot = std::move(value);
+    }
 
-        if (enclosing) {
-            return enclosing->get(name);
-        }
+    // Looks up a variable in the current scope or parent scopes. The
+    // reference stays valid until the variable is assigned or its scope ends.
 
+    const Value& lookup(const Token& name) {
+        if (Value* slot = findSlot(name.lexeme)) return *slot;
         std::cerr << "Runtime Error: Undefined variable '" << name.lexeme << "'\n";
-        exit(1);
+        drimExit(1);
     }
 
+    // Copying form of lookup, for callers that keep the value
+    Value get(const Token& name) { return lookup(name); }
+
     //Define a variable strictly in the current scope (for the params)
     void define (const std::string& name, Value value) {
-        values[name] = value;
+        localSlot(name) = std::move(value);
     }
 
     bool hasArray(const std::string& name) {
-        if (arrays.count(name)) return true;
-        if (enclosing) return enclosing->hasArray(name);
-        return false;
+        Value* slot = findSlot(name);
+        return slot && isArray(*slot);
     }
 
     void declareArray(const Token& name) {
-        if (values.count(name.lexeme)) {
+        MemTag tag(MEM_ARRAYS);
+        Symbol& symbol = symbols.insert(name.lexeme, SymbolTable::hashOf(name.lexeme));
+        if (symbol.hasValue && !isArray(symbol.value)) {
             std::cerr << "Runtime Error: '" << name.lexeme << "' already exists as a variable in current scope\n";
-            exit(1);
+            drimExit(1);
         }
-        if (!arrays.count(name.lexeme)) {
-            arrays[name.lexeme] = {};
-            arrayElementTypes[name.lexeme] = "";
+        if (!symbol.hasValue) {
+            symbol.value = Value(Array{std::make_shared<ArrayBuffer>()});
+            symbol.hasValue = true;
         }
     }
 
-    void assignArray(const Token& name, const std::vector<Value>& elements) {
-        if (findValueOwner(name.lexeme)) {
-            std::cerr << "Runtime Error: '" << name.lexeme << "' already exists as a variable\n";
-            exit(1);
-        }
-
+    // Builds an array value from literal elements, which must share one type
+    static Array makeArray(std::vector<Value> elements, const std::string& name) {
+        MemTag tag(MEM_ARRAYS);
         std::string inferred = "";
         for (const auto& element : elements) {
             std::string currentType = inferValueTypeName(element);
             if (inferred.empty()) {
                 inferred = currentType;
             } else if (currentType != inferred) {
-                std::cerr << "Runtime Error: Mixed array literal types for '" << name.lexeme
-                          << "'. Expected " << inferred << " but got " << currentType << "\n";
-                exit(1);
+                std::cerr << "Runtime Error: Mixed array literal types" << (name.empty() ? "" : " for '" + name + "'")
+                          << ". Expected " << inferred << " but got " << currentType << "\n";
+                drimExit(1);
             }
         }
+        Array arr{std::make_shared<ArrayBuffer>()};
+        arr.length = elements.size();
+        arr.buffer->items = std::move(elements);
+        arr.buffer->elementType = inferred;
+        return arr;
+    }
 
-        Scope* owner = findArrayOwner(name.lexeme);
-        if (!owner) owner = this;
-        owner->arrays[name.lexeme] = elements;
-        owner->arrayElementTypes[name.lexeme] = inferred;
+    void assignArray(const Token& name, std::vector<Value> elements) {
+        Scope* owner = nullptr;
+        Value* slot = findSlot(name.lexeme, &owner);
+        if (slot && !isArray(*slot)) {
+            std::cerr << "Runtime Error: '" << name.lexeme << "' already exists as a variable\n";
+            drimExit(1);
+        }
+        Array arr = makeArray(std::move(elements), name.lexeme);
+        if (!slot) slot = &localSlot(name.lexeme);
+        else if (inParallel && sharedBoundary(owner)) {
+            std::cerr << "Runtime Error: Cannot replace shared array '" << name.lexeme
+                      << "' inside drimming parallel\n";
+            drimExit(1);
+        }
+        *slot = Value(std::move(arr));
     }
 
     void assignArrayElement(const Token& name, int index, Value value) {
+        MemTag tag(MEM_ARRAYS);
         if (index < 0) {
             std::cerr << "Runtime Error: Array index cannot be negative for '" << name.lexeme << "'\n";
-            exit(1);
+            drimExit(1);
         }
 
-        if (findValueOwner(name.lexeme)) {
-            std::cerr << "Runtime Error: '" << name.lexeme << "' is a variable, not an array\n";
-            exit(1);
+        Scope* owner;
+        Array& arr = writableArray(name, owner);
+
+        Scope* boundary = inParallel ? sharedBoundary(owner) : nullptr;
+        if (boundary) {
+            // Shared arrays may not grow inside a parallel loop, so their
+            // element type is already fixed and only the slot is written.
+            // The loop gave each array its body writes an exclusive buffer
+            // before starting (see unshareArray).
+            if (index >= static_cast<int>(arr.size())) {
+                std::cerr << "Runtime Error: drimming parallel can only write shared array '"
+                          << name.lexeme << "' within its current size\n";
+                drimExit(1);
+            }
+            claimParallelWrite(boundary->parallel, boundary->parallelIteration, name.lexeme, arr.buffer->items, index);
+        } else {
+            arr.makeExclusive();
         }
 
-        Scope* owner = findArrayOwner(name.lexeme);
-        if (!owner) {
-            owner = rootScope();
-            owner->arrays[name.lexeme] = {};
-            owner->arrayElementTypes[name.lexeme] = "";
+        checkElementType(name, arr, value);
+
+        std::vector<Value>& items = arr.buffer->items;
+        if (index >= static_cast<int>(items.size())) {
+            items.resize(index + 1, 0LL);
+            arr.length = items.size();
         }
+        items[arr.offset + index] = std::move(value);
+    }
 
-        std::string currentType = inferValueTypeName(value);
-        std::string& expectedType = owner->arrayElementTypes[name.lexeme];
-        if (expectedType.empty()) {
-            expectedType = currentType;
-        } else if (expectedType != currentType) {
-            std::cerr << "Runtime Error: Array value type is '" << currentType
-                      << "', must be matched with '" << expectedType << "' for array '"
-                      << name.lexeme << "'\n";
-            exit(1);
+    // Bulk form of assignArrayElement: stores values at indices 0..n-1
+    void assignArrayPrefix(const Token& name, std::vector<Value>& elements) {
+        MemTag tag(MEM_ARRAYS);
+        Scope* owner;
+        Array& arr = writableArray(name, owner);
+        arr.makeExclusive();
+
+        for (const auto& element : elements) checkElementType(name, arr, element);
+
+        std::vector<Value>& items = arr.buffer->items;
+        if (items.size() < elements.size()) {
+            items.resize(elements.size(), 0LL);
+            arr.length = items.size();
         }
+        std::move(elements.begin(), elements.end(), items.begin());
+    }
 
-        std::vector<Value>& arr = owner->arrays[name.lexeme];
-        if (index >= static_cast<int>(arr.size())) {
-            arr.resize(index + 1, 0LL);
+    // Read-only view of a whole array (drimming parallel iterates it in place)
+    const Array& getArray(const Token& name) {
+        Value* slot = findSlot(name.lexeme);
+        auto arr = slot ? std::get_if<Array>(&slot->data) : nullptr;
+        if (!arr) {
+            std::cerr << "Runtime Error: Undefined array '" << name.lexeme << "'\n";
+            drimExit(1);
         }
-        arr[index] = value;
+        return *arr;
+    }
+
+    // Gives array `name`, if there is one, a buffer no other array shares
+    void unshareArray(const std::string& name) {
+        Value* slot = findSlot(name);
+        if (auto arr = slot ? std::get_if<Array>(&slot->data) : nullptr) arr->makeExclusive();
     }
 
-    Value getArrayElement(const Token& name, int index) {
+    // The element in place; valid until the array is next written
+    const Value& getArrayElement(const Token& name, int index) {
         if (index < 0) {
             std::cerr << "Runtime Error: Array index cannot be negative for '" << name.lexeme << "'\n";
-            exit(1);
+            drimExit(1);
         }
 
-        Scope* owner = findArrayOwner(name.lexeme);
-        if (!owner) {
-            std::cerr << "Runtime Error: Undefined array '" << name.lexeme << "'\n";
-            exit(1);
-        }
-
-        std::vector<Value>& arr = owner->arrays[name.lexeme];
+        const Array& arr = getArray(name);
         if (index >= static_cast<int>(arr.size())) {
             std::cerr << "Runtime Error: Array index out of bounds for '" << name.lexeme << "'\n";
-            exit(1);
+            drimExit(1);
         }
 
         return arr[index];
     }
 
+    // arr[start:end] -- shares arr's buffer, nothing is copied
+    Array getArraySlice(const Token& name, long long start, long long end) {
+        Array slice = getArray(name);
+        if (end < 0) end = (long long)slice.size();
+        if (start < 0 || start > end || end > (long long)slice.size()) {
+            std::cerr << "Runtime Error: Slice [" << start << ":" << end << "] out of bounds for '"
+                      << name.lexeme << "' of size " << slice.size() << "\n";
+            drimExit(1);
+        }
+        slice.offset += (size_t)start;
+        slice.length = (size_t)(end - start);
+        return slice;
+    }
+
     void defineFunc(const std::string& name, std::shared_ptr<FunctionStmt> func) {
-        functions[name] = func;
+        symbols.insert(name, SymbolTable::hashOf(name)).function = func;
     }
 
     std::shared_ptr<FunctionStmt> getFunc(const std::string& name) {
-        if (functions.count(name)) {
-            return functions[name];
-        }
-        if (enclosing) {
-            return enclosing->getFunc(name);
+        size_t hash = SymbolTable::hashOf(name);
+        for (Scope* current = this; current; current = current->enclosing.get()) {
+            Symbol* symbol = current->symbols.find(name, hash);
+            if (symbol && symbol->function) return symbol->function;
         }
         return nullptr;
     }
 
+    // Copies every function visible from here into `into` (inner definitions win)
+    void collectFunctions(Scope& into) {
+        if (enclosing) enclosing->collectFunctions(into);
+        symbols.forEach([&](const Symbol& symbol) {
+            if (symbol.function) into.defineFunc(symbol.name, symbol.function);
+        });
+    }
+
     std::shared_ptr<Scope> getEnclosing() { return enclosing; }
 };
 
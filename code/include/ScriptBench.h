@@ -0,0 +1,18 @@
+#ifndef SCRIPT_BENCH_H
+#define SCRIPT_BENCH_H
+
+#include <string>
+
+struct ScriptBenchOptions {
+    int runs = 10;
+    int warmup = 1;
+    std::string inputPath;   // recorded stdin replayed on every run, optional
+    bool useJit = false;
+    int jitThreshold = 1000;
+};
+
+// drim --bench N script.drim: runs the whole pipeline N times in this process
+// with wake output discarded and prints per-phase timings plus peak RSS.
+int runScriptBench(const std::string& scriptPath, const ScriptBenchOptions& options);
+
+#endif
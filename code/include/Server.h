@@ -0,0 +1,17 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <string>
+
+// drim --serve /path/sock: a warm process that runs scripts for clients on
+// a local Unix socket. Scripts are compiled once and recompiled only when
+// the file changes; requests run on --threads workers. Returns on failure
+// to set up the socket, otherwise serves until killed.
+int runServer(const std::string& socketPath);
+
+// drim --client /path/sock script.drim: runs the script on the server with
+// this process's stdin, writes its output and errors to stdout/stderr, and
+// returns the script's exit status, just like running `drim script.drim`.
+int runClient(const std::string& socketPath, const std::string& scriptPath);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include "Value.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct FunctionStmt;
+
+// Everything one scope knows about a name: the variable or array stored
+// under it (arrays are Array values and carry their own element type) and
+// the function defined under it. Variables and functions have separate
+// namespaces, so a name can have both.
+struct Symbol {
+    std::string name;
+    size_t hash = 0;
+    bool used = false;
+    bool hasValue = false;
+    Value value;
+    std::shared_ptr<FunctionStmt> function;
+};
+
+// Flat open-addressing table of a scope's symbols (linear probing,
+// power-of-two capacity). Scopes never forget a name, so there are no
+// tombstones. Nothing is allocated until the first insert, since most
+// block scopes never define anything. Pointers to symbols stay valid until
+// the next insert into the same table.
+class SymbolTable {
+    std::unique_ptr<Symbol[]> slots;
+    size_t capacity = 0;
+    size_t count = 0;
+
+    void grow() {
+        size_t bigger = capacity ? capacity * 2 : 8;
+        std::unique_ptr<Symbol[]> old = std::move(slots);
+        size_t oldCapacity = capacity;
+        slots.reset(new Symbol[bigger]);
+        capacity = bigger;
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (!old[i].used) continue;
+            size_t at = old[i].hash & (capacity - 1);
+            while (slots[at].used) at = (at + 1) & (capacity - 1);
+            slots[at] = std::move(old[i]);
+        }
+    }
+
+public:
+    // FNV-1a; computed once per lookup and reused at every scope level
+    static size_t hashOf(const std::string& name) {
+        uint64_t h = 1469598103934665603ULL;
+        for (unsigned char c : name) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return (size_t)h;
+    }
+
+    Symbol* find(const std::string& name, size_t hash) {
+        if (!count) return nullptr;
+        for (size_t at = hash & (capacity - 1); slots[at].used; at = (at + 1) & (capacity - 1)) {
+            if (slots[at].hash == hash && slots[at].name == name) return &slots[at];
+        }
+        return nullptr;
+    }
+
+    // The symbol for `name`, added empty if this table has none yet
+    Symbol& insert(const std::string& name, size_t hash) {
+        if (Symbol* found = find(name, hash)) return *found;
+        MemTag tag(MEM_SCOPES);
+        if ((count + 1) * 4 > capacity * 3) grow();
+        size_t at = hash & (capacity - 1);
+        while (slots[at].used) at = (at + 1) & (capacity - 1);
+        Symbol& symbol = slots[at];
+        symbol.name = name;
+        symbol.hash = hash;
+        symbol.used = true;
+        count++;
+        return symbol;
+    }
+
+    template <typename F>
+    void forEach(F visit) const {
+        for (size_t i = 0; i < capacity; i++) {
+            if (slots[i].used) visit(slots[i]);
+        }
+    }
+};
+
+#endif
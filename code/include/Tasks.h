@@ -0,0 +1,68 @@
+#ifndef TASKS_H
+#define TASKS_H
+
+#include "Value.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct FunctionStmt;
+class Scope;
+
+// A spawned call: `t = spawn f(x)` creates one, `await(t)` waits for it.
+// The body runs in its own Scope holding only the arguments and the
+// functions visible at the spawn, so tasks never share variables.
+struct Task {
+    enum State { QUEUED, RUNNING, DONE };
+
+    std::shared_ptr<FunctionStmt> func;
+    std::shared_ptr<Scope> scope;
+    HostCall hostCall; // the spawner's, if embedded
+    std::atomic<int> state{QUEUED};
+    Value result;
+
+    std::mutex lock;
+    std::condition_variable finished;
+};
+
+// Fixed-size work-stealing scheduler for tasks. Each worker owns a deque:
+// it pushes and pops its own spawns at the back (newest first, cache-warm)
+// and steals from the front of the others' when it runs dry. A thread that
+// awaits an unfinished task runs queued tasks itself instead of blocking.
+class TaskScheduler {
+public:
+    static TaskScheduler& instance();
+
+    void spawn(const std::shared_ptr<Task>& task);
+    Value await(const std::shared_ptr<Task>& task);
+    // Waits for every spawned task (the script ends only after all of them)
+    void drain();
+
+private:
+    struct Worker {
+        std::mutex lock;
+        std::deque<std::shared_ptr<Task>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<size_t> nextVictim{0};
+    std::atomic<long long> outstanding{0};
+    std::mutex idleLock;
+    size_t queued = 0; // deque entries, guarded by idleLock
+    std::condition_variable idle;
+    std::condition_variable drained;
+    std::once_flag started;
+
+    TaskScheduler() = default;
+    void start();
+    void workerLoop(size_t id);
+    std::shared_ptr<Task> findWork(size_t home);
+    void run(const std::shared_ptr<Task>& task);
+};
+
+#endif
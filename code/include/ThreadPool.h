@@ -0,0 +1,46 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads for drimming parallel. Threads start on first
+// use and then sleep between loops, so a parallel loop costs a wakeup rather
+// than a thread spawn. The calling thread always takes part as worker 0.
+class ThreadPool {
+public:
+    static ThreadPool& instance();
+
+    // Worker count including the caller. Only honoured before first use;
+    // 0 means one per hardware thread.
+    void setThreads(size_t count);
+    size_t size();
+    // The worker count size() will report, without starting any threads
+    size_t configuredSize();
+
+    // Runs job(worker) for every worker and returns when all have finished.
+    // A call made while the pool is already busy runs job(0) alone.
+    void runOnAll(const std::function<void(size_t)>& job);
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)>* job = nullptr;
+    unsigned long long generation = 0;
+    size_t remaining = 0;
+    size_t wanted = 0;
+    bool started = false;
+    bool busy = false;
+
+    ThreadPool() = default;
+    void start();
+    void workerLoop(size_t id);
+};
+
+#endif
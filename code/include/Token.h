@@ -61,6 +61,8 @@ enum TokenType {
     TOKEN_COMMA,      // ,
     TOKEN_LBRACE,     // {
     TOKEN_RBRACE,     // }
+    TOKEN_DOT_DOT,    // .. (ranges in drimming parallel)
+    TOKEN_COLON,      // : (reduce clauses)
 
     TOKEN_EOF,
     TOKEN_ERROR
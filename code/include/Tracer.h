@@ -0,0 +1,87 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Timeline tracer behind --trace=out.json. Begin/end events go into a ring
+// buffer allocated up front (the oldest events are overwritten once it is
+// full) and are only turned into Chrome trace-event JSON at exit, for
+// chrome://tracing or ui.perfetto.dev.
+// Event names are not copied: they must be string literals or AST lexemes,
+// which is why finish() runs before main() lets the AST go.
+class Tracer {
+public:
+    static Tracer& start(const std::string& jsonPath);
+    // The running tracer, or nullptr; interpreters pick it up when created
+    static Tracer* active() { return current; }
+
+    // The TSC where there is one (converted to wall time at finish),
+    // otherwise the steady clock in nanoseconds
+    static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    void begin(const char* name, const char* category) { record(name, category, 'B'); }
+    void end(const char* name, const char* category) { record(name, category, 'E'); }
+
+    // Writes the JSON file; only the first call does anything
+    void finish();
+
+    struct Span {
+        Tracer* t;
+        const char* name;
+        const char* category;
+        Span(Tracer* tracer, const char* n, const char* c) : t(tracer), name(n), category(c) {
+            if (t) t->begin(name, category);
+        }
+        ~Span() {
+            if (t) t->end(name, category);
+        }
+    };
+
+private:
+    static const size_t CAPACITY = 1 << 20;
+
+    struct Event {
+        uint64_t ticks;
+        const char* name;
+        const char* category;
+        uint32_t thread;
+        char phase;
+    };
+
+    static Tracer* current;
+
+    Event* events;
+    std::atomic<uint64_t> next{0};
+    std::string jsonPath;
+    uint64_t startTicks;
+    uint64_t startNs;
+    std::atomic<bool> finished{false};
+
+    explicit Tracer(const std::string& path);
+    static uint32_t threadId();
+
+    void record(const char* name, const char* category, char phase) {
+        Event& e = events[next.fetch_add(1, std::memory_order_relaxed) & (CAPACITY - 1)];
+        e.ticks = ticks();
+        e.name = name;
+        e.category = category;
+        e.thread = threadId();
+        e.phase = phase;
+    }
+};
+
+#endif
@@ -7,25 +7,64 @@
 #include <vector>
 #include <memory>
 #include <type_traits>
+#include <charconv>
+#include <functional>
+#include "MemStats.h"
+
+// drim's float type. long double (80-bit x87 on x86-64) unless built with
+// -DDRIM_DOUBLE_FLOATS=ON, which uses double: half the size, SSE math, and
+// faster pow, fmod and parsing, at about 16 instead of 19 significant digits.
+#ifdef DRIM_DOUBLE_FLOATS
+using DrimFloat = double;
+#else
+using DrimFloat = long double;
+#endif
 
 // Forward declaration
 struct AnyValue;
+struct ArrayBuffer;
+struct Task; // Tasks.h
+class Map;   // Map.h
+size_t mapSize(const Map& map);
+
+// An array value: a window onto a buffer that copies of the array (and
+// slices of it) share. Copying one is O(1); Scope gives an array a buffer
+// of its own before writing to it (copy-on-write).
+struct Array {
+    std::shared_ptr<ArrayBuffer> buffer;
+    size_t offset = 0;
+    size_t length = 0;
+
+    size_t size() const { return length; }
+    const AnyValue& operator[](size_t i) const;
+    // True if writes can go straight into the buffer
+    bool exclusive() const;
+    // Copies the elements into a buffer owned by this array alone, unless
+    // it already has one
+    void makeExclusive();
+
+    bool operator==(const Array& other) const;
+    bool operator!=(const Array& other) const { return !(*this == other); }
+};
 
 // A traditional way to handle recursive Value types (like stacks containing values)
 struct AnyValue {
     std::variant<
         long long, 
-        long double, 
+        DrimFloat, 
         std::string, 
         bool, 
-        std::shared_ptr<std::vector<AnyValue>> 
+        std::shared_ptr<std::vector<AnyValue>>,
+        std::shared_ptr<Task>,
+        Array,
+        std::shared_ptr<Map>
     > data;
 
     // Constructors for convenience
     AnyValue() : data(false) {}
     
     AnyValue(long long v) : data(v) {}
-    AnyValue(long double v) : data(v) {}
+    AnyValue(DrimFloat v) : data(v) {}
     AnyValue(std::string v) : data(v) {}
     AnyValue(const char* v) : data(std::string(v)) {}
     
@@ -34,6 +73,9 @@ struct AnyValue {
     AnyValue(T v) : data(v) {}
 
     AnyValue(std::shared_ptr<std::vector<AnyValue>> v) : data(v) {}
+    AnyValue(std::shared_ptr<Task> v) : data(v) {}
+    AnyValue(Array v) : data(std::move(v)) {}
+    AnyValue(std::shared_ptr<Map> v) : data(std::move(v)) {}
 
     // Equality operator for variant comparison
     bool operator==(const AnyValue& other) const { return data == other.data; }
@@ -43,18 +85,81 @@ struct AnyValue {
 // Redefine Value as AnyValue
 using Value = AnyValue;
 
+struct ArrayBuffer {
+    std::vector<AnyValue> items;
+    std::string elementType; // empty until the first element is stored
+
+    // --mem-stats lists the largest live buffers with where they were made
+    ArrayBuffer() {
+        if (MemStats::enabled()) MemStats::trackArray(this);
+    }
+    ~ArrayBuffer() {
+        if (MemStats::enabled()) MemStats::untrackArray(this);
+    }
+    ArrayBuffer(const ArrayBuffer&) = delete;
+    ArrayBuffer& operator=(const ArrayBuffer&) = delete;
+};
+
+inline const AnyValue& Array::operator[](size_t i) const { return buffer->items[offset + i]; }
+
+inline bool Array::exclusive() const {
+    return buffer && buffer.use_count() == 1 && offset == 0 && length == buffer->items.size();
+}
+
+inline void Array::makeExclusive() {
+    if (exclusive()) return;
+    MemTag tag(MEM_ARRAYS);
+    auto own = std::make_shared<ArrayBuffer>();
+    if (buffer) {
+        auto first = buffer->items.begin() + (std::ptrdiff_t)offset;
+        own->items.assign(first, first + (std::ptrdiff_t)length);
+        own->elementType = buffer->elementType;
+    }
+    buffer = std::move(own);
+    offset = 0;
+}
+
+inline bool Array::operator==(const Array& other) const {
+    if (length != other.length) return false;
+    for (size_t i = 0; i < length; i++) {
+        if (!((*this)[i] == other[i])) return false;
+    }
+    return true;
+}
+
+// Calls a function the embedding host registered (see Drim.h). Returns false
+// if `name` is not one of the host's, so the builtins get their turn.
+using HostCall = std::function<bool(const std::string& name, const Value* args, size_t count, Value& result)>;
+
 // Printer Helper
+// Ints and strings skip the ostream formatting machinery and go straight
+// into std::cout's buffer.
 inline void printValue(const Value& v) {
-    if (std::holds_alternative<long long>(v.data)) 
-        std::cout << std::get<long long>(v.data);
-    else if (std::holds_alternative<long double>(v.data)) 
-        std::cout << std::get<long double>(v.data);
-    else if (std::holds_alternative<std::string>(v.data)) 
-        std::cout << std::get<std::string>(v.data);
+    if (auto i = std::get_if<long long>(&v.data)) {
+        char digits[24];
+        auto res = std::to_chars(digits, digits + sizeof(digits), *i);
+        std::cout.write(digits, res.ptr - digits);
+    }
+    else if (std::holds_alternative<DrimFloat>(v.data)) 
+        std::cout << std::get<DrimFloat>(v.data);
+    else if (auto s = std::get_if<std::string>(&v.data))
+        std::cout.write(s->data(), (std::streamsize)s->size());
     else if (std::holds_alternative<bool>(v.data))
         std::cout << (std::get<bool>(v.data) ? "true" : "false");
     else if (std::holds_alternative<std::shared_ptr<std::vector<AnyValue>>>(v.data))
         std::cout << "<stack size=" << std::get<std::shared_ptr<std::vector<AnyValue>>>(v.data)->size() << ">";
+    else if (std::holds_alternative<std::shared_ptr<Task>>(v.data))
+        std::cout << "<task>";
+    else if (auto m = std::get_if<std::shared_ptr<Map>>(&v.data))
+        std::cout << "<map size=" << mapSize(**m) << ">";
+    else if (auto a = std::get_if<Array>(&v.data)) {
+        std::cout.put('[');
+        for (size_t i = 0; i < a->size(); i++) {
+            if (i) std::cout.write(", ", 2);
+            printValue((*a)[i]);
+        }
+        std::cout.put(']');
+    }
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include "../include/Batch.h"
+#include "../include/Lexer.h"
+#include "../include/Parser.h"
+#include "../include/Interpreter.h"
+#include "../include/Output.h"
+#include "../include/Signal.h"
+#include "../include/Input.h"
+#include "../include/Error.h"
+#include "../include/ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Job {
+    int line = 0;
+    std::string script;
+    std::string input;   // "-" for none
+    std::string output;  // "-" to discard
+    int status = 0;      // 0 ok, 1 script error, 2 I/O error
+    std::string error;   // everything the job wrote to std::cerr
+    double ms = 0.0;
+};
+
+// A lexed and parsed script. The AST is only read while interpreting, so
+// one Program serves every job that runs the same source.
+struct Program {
+    std::string source;
+    std::vector<std::shared_ptr<Stmt>> commands;
+    int status = 0;      // nonzero if lexing/parsing failed
+    std::string error;   // and its message
+};
+
+class ParseCache {
+public:
+    std::shared_ptr<const Program> get(const std::string& source) {
+        std::shared_ptr<Entry> entry;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            std::shared_ptr<Entry>& slot = entries[hashOf(source)];
+            if (!slot) slot = std::make_shared<Entry>();
+            entry = slot;
+        }
+
+        bool parsedHere = false;
+        std::call_once(entry->once, [&] {
+            entry->program.source = source;
+            compile(entry->program);
+            parsedHere = true;
+        });
+        if (!parsedHere) hits.fetch_add(1, std::memory_order_relaxed);
+
+        if (entry->program.source != source) {
+            // 64-bit hash collision: parse this one privately
+            auto program = std::make_shared<Program>();
+            program->source = source;
+            compile(*program);
+            return program;
+        }
+        return std::shared_ptr<const Program>(entry, &entry->program);
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> guard(lock);
+        return entries.size();
+    }
+
+    std::atomic<size_t> hits{0};
+
+private:
+    struct Entry {
+        std::once_flag once;
+        Program program;
+    };
+
+    std::mutex lock;
+    std::unordered_map<unsigned long long, std::shared_ptr<Entry>> entries;
+
+    // FNV-1a
+    static unsigned long long hashOf(const std::string& text) {
+        unsigned long long h = 1469598103934665603ULL;
+        for (unsigned char c : text) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    // The parse error is kept in the Program so every job on the same
+    // source reports it, not just the one that parsed it
+    static void compile(Program& program) {
+        std::string parseError;
+        OutputBuffer::captureThread(nullptr, &parseError);
+        setThrowOnExit(true);
+        try {
+            Lexer lexer(program.source);
+            lexer.scanTokens();
+            Parser parser(lexer.tokens);
+            program.commands = parser.parse();
+        } catch (ScriptExit& e) {
+            program.status = e.status;
+        }
+        setThrowOnExit(false);
+        OutputBuffer::captureThread(nullptr, nullptr);
+        program.error = parseError;
+    }
+};
+
+bool readFile(const std::string& path, std::string& out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    out = buffer.str();
+    return true;
+}
+
+double nowMs() {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void runJob(Job& job, ParseCache& cache) {
+    double start = nowMs();
+    std::string source, input, output;
+
+    if (!readFile(job.script, source)) {
+        job.status = 2;
+        job.error = "Error: Could not open script '" + job.script + "'\n";
+        return;
+    }
+    if (job.input != "-" && !readFile(job.input, input)) {
+        job.status = 2;
+        job.error = "Error: Could not open input '" + job.input + "'\n";
+        return;
+    }
+
+    std::shared_ptr<const Program> program = cache.get(source);
+    if (program->status != 0) {
+        job.status = program->status;
+        job.error = program->error;
+    } else {
+        std::unique_ptr<InputBuffer> in = InputBuffer::fromText(input);
+        InputBuffer::useForThread(in.get());
+        OutputBuffer::captureThread(&output, &job.error);
+        setThrowOnExit(true);
+        try {
+            Interpreter interpreter;
+            interpreter.interpret(program->commands);
+        } catch (ReturnValue&) {
+        } catch (BreakSignal&) {
+        } catch (ContinueSignal&) {
+        } catch (ScriptExit& e) {
+            job.status = e.status;
+        } catch (const std::exception& e) {
+            // e.g. bad_alloc: fail this job, keep the pool and the batch alive
+            job.status = 1;
+            job.error += std::string("Runtime Error: ") + e.what() + "\n";
+        }
+        setThrowOnExit(false);
+        OutputBuffer::captureThread(nullptr, nullptr);
+        InputBuffer::useForThread(nullptr);
+    }
+
+    if (job.output != "-") {
+        std::ofstream out(job.output, std::ios::binary);
+        out.write(output.data(), (std::streamsize)output.size());
+        if (!out) {
+            job.status = 2;
+            job.error += "Error: Could not write output '" + job.output + "'\n";
+        }
+    }
+    job.ms = nowMs() - start;
+}
+
+bool loadJobs(const std::string& path, std::vector<Job>& jobs) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+    std::string text;
+    int lineNo = 0;
+    while (std::getline(file, text)) {
+        lineNo++;
+        std::istringstream fields(text);
+        Job job;
+        job.line = lineNo;
+        if (!(fields >> job.script) || job.script[0] == '#') continue;
+        if (!(fields >> job.input)) job.input = "-";
+        if (!(fields >> job.output)) job.output = "-";
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+// First line of a job's error output, for the summary
+std::string firstLine(const std::string& text) {
+    size_t nl = text.find('\n');
+    return nl == std::string::npos ? text : text.substr(0, nl);
+}
+
+}
+
+int runBatch(const BatchOptions& options) {
+    std::vector<Job> jobs;
+    if (!loadJobs(options.jobsPath, jobs)) {
+        std::cerr << "Error: Could not open jobs file '" << options.jobsPath << "'\n";
+        return 1;
+    }
+
+    if (options.jobs > 0) ThreadPool::instance().setThreads(options.jobs);
+    ParseCache cache;
+    std::atomic<size_t> next{0};
+    double start = nowMs();
+
+    ThreadPool::instance().runOnAll([&](size_t) {
+        size_t i;
+        while ((i = next.fetch_add(1, std::memory_order_relaxed)) < jobs.size()) {
+            runJob(jobs[i], cache);
+        }
+    });
+
+    double elapsed = nowMs() - start;
+    size_t failed = 0;
+    char row[64];
+    for (const Job& job : jobs) {
+        if (job.status != 0) failed++;
+        std::snprintf(row, sizeof(row), "%4d  status %d  %9.3f ms  ", job.line, job.status, job.ms);
+        std::cout << row << job.script;
+        if (job.status != 0) std::cout << "  " << firstLine(job.error);
+        std::cout << "\n";
+    }
+    std::snprintf(row, sizeof(row), "%.3f", elapsed);
+    std::cout << "drim batch: " << jobs.size() << " jobs, " << jobs.size() - failed << " ok, " << failed
+              << " failed, " << cache.size() << " distinct scripts (" << cache.hits.load()
+              << " parse cache hits), " << ThreadPool::instance().size() << " threads, " << row << " ms\n";
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+#include "../include/Budget.h"
+#include "../include/Error.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+bool Budget::active = false;
+size_t Budget::memoryLimit = 0;
+std::atomic<long long> Budget::heapBytes{0};
+std::atomic<bool> Budget::timeUp{false};
+
+namespace {
+// Steps between checks. Small enough that time and memory are looked at
+// every millisecond or so, large enough that refuel() never shows up in a
+// profile.
+const long long ALLOWANCE = 1 << 14;
+
+unsigned long long stepLimit = 0;
+std::atomic<unsigned long long> stepsGranted{0};
+bool timeLimited = false;
+double timeLimit = 0;
+std::chrono::steady_clock::time_point deadline;
+
+void describeBytes(std::ostream& out, size_t bytes) {
+    char text[32];
+    if (bytes >= 1 << 20) std::snprintf(text, sizeof(text), "%.1f MiB", bytes / double(1 << 20));
+    else std::snprintf(text, sizeof(text), "%.1f KiB", bytes / double(1 << 10));
+    out << text;
+}
+}
+
+void Budget::limitSteps(unsigned long long steps) {
+    stepLimit = steps;
+    active = true;
+}
+
+void Budget::limitTime(double seconds) {
+    timeLimited = true;
+    timeLimit = seconds;
+    deadline = std::chrono::steady_clock::now() +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+    active = true;
+    std::thread([] {
+        std::this_thread::sleep_until(deadline);
+        timeUp.store(true, std::memory_order_relaxed);
+    }).detach();
+}
+
+void Budget::limitMemory(size_t bytes) {
+    memoryLimit = bytes;
+    active = true;
+}
+
+long long Budget::refuel() {
+    if (!active) return LLONG_MAX;
+
+    if (timeLimited && std::chrono::steady_clock::now() >= deadline) {
+        std::cerr << "Runtime Error: Time limit of " << timeLimit << "s exceeded.\n";
+        drimExit(1);
+    }
+
+    if (memoryLimit && heapBytes.load(std::memory_order_relaxed) > (long long)memoryLimit) memoryExceeded();
+
+    if (!stepLimit) return ALLOWANCE;
+
+    unsigned long long granted = stepsGranted.load(std::memory_order_relaxed);
+    long long grant;
+    do {
+        if (granted >= stepLimit) {
+            std::cerr << "Runtime Error: Step limit of " << stepLimit << " exceeded.\n";
+            drimExit(1);
+        }
+        grant = (long long)std::min<unsigned long long>(ALLOWANCE, stepLimit - granted);
+    } while (!stepsGranted.compare_exchange_weak(granted, granted + grant, std::memory_order_relaxed));
+    return grant;
+}
+
+void Budget::memoryExceeded(size_t requested) {
+    // The first thread over the limit reports it. Counting stops, so that
+    // reporting and exiting may allocate; any other thread waits for the exit.
+    static std::atomic<bool> reported{false};
+    if (reported.exchange(true)) {
+        while (true) std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    size_t limit = memoryLimit;
+    long long used = heapBytes.load(std::memory_order_relaxed);
+    memoryLimit = 0;
+    std::cerr << "Runtime Error: Memory limit of ";
+    describeBytes(std::cerr, limit);
+    std::cerr << " exceeded (";
+    describeBytes(std::cerr, (size_t)used);
+    std::cerr << " in use";
+    if (requested) {
+        std::cerr << ", ";
+        describeBytes(std::cerr, requested);
+        std::cerr << " more requested";
+    }
+    std::cerr << ").\n";
+    drimExit(1);
+}
+
+void Budget::giveBack(long long steps) {
+    if (stepLimit && steps > 0) stepsGranted.fetch_sub((unsigned long long)steps, std::memory_order_relaxed);
+}
@@ -0,0 +1,217 @@
+#include "../include/Collector.h"
+#include "../include/Map.h"
+#include "../include/Output.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+
+std::atomic<size_t> minTrigger{4u << 20};
+
+// Totals over all threads
+std::atomic<unsigned long long> runs{0};
+std::atomic<unsigned long long> skipped{0};
+std::atomic<unsigned long long> reclaimedCollections{0};
+std::atomic<unsigned long long> reclaimedBytes{0};
+std::atomic<unsigned long long> pauseNsTotal{0};
+std::atomic<unsigned long long> pauseNsMax{0};
+
+// Rough heap footprint of one collection, for the trigger and the stats
+size_t footprint(const std::vector<Value>& list) {
+    size_t bytes = sizeof(std::vector<Value>) + 32 + list.capacity() * sizeof(Value);
+    for (const Value& v : list) {
+        if (auto s = std::get_if<std::string>(&v.data)) bytes += s->capacity();
+    }
+    return bytes;
+}
+
+size_t footprint(const Map& map) {
+    size_t bytes = sizeof(Map) + 32 + map.size() * (2 * sizeof(Value) + 16);
+    map.forEachValue([&](const Value& v) {
+        if (auto s = std::get_if<std::string>(&v.data)) bytes += s->capacity();
+    });
+    return bytes;
+}
+
+// The stack, queue, map or array buffer a value refers to, if any
+const void* referentOf(const Value& v) {
+    if (auto list = std::get_if<std::shared_ptr<std::vector<Value>>>(&v.data)) return list->get();
+    if (auto map = std::get_if<std::shared_ptr<Map>>(&v.data)) return map->get();
+    if (auto array = std::get_if<Array>(&v.data)) return array->buffer.get();
+    return nullptr;
+}
+
+}
+
+CycleCollector& CycleCollector::forThread() {
+    static thread_local CycleCollector collector;
+    return collector;
+}
+
+CycleCollector::CycleCollector() : trigger(minTrigger.load(std::memory_order_relaxed)) {}
+
+void CycleCollector::setMinTrigger(size_t bytes) {
+    minTrigger.store(std::max<size_t>(bytes, 1), std::memory_order_relaxed);
+}
+
+void CycleCollector::track(const std::shared_ptr<std::vector<Value>>& collection) {
+    tracked.push_back({collection, Kind::LIST});
+    noteAllocation(sizeof(std::vector<Value>) + 32);
+}
+
+void CycleCollector::track(const std::shared_ptr<Map>& map) {
+    tracked.push_back({map, Kind::MAP});
+    noteAllocation(sizeof(Map) + 32);
+}
+
+size_t CycleCollector::collect() {
+    allocated = 0;
+    if (OutputBuffer::concurrent()) {
+        skipped.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    // Hold every live collection for the duration of the pass, so each use
+    // count is one higher than the references the program holds
+    std::vector<std::shared_ptr<void>> held;
+    std::vector<Kind> kinds;
+    held.reserve(tracked.size());
+    kinds.reserve(tracked.size());
+    std::unordered_map<const void*, size_t> index;
+    index.reserve(tracked.size() * 2);
+    for (const Tracked& entry : tracked) {
+        if (auto strong = entry.object.lock()) {
+            index.emplace(strong.get(), held.size());
+            held.push_back(std::move(strong));
+            kinds.push_back(entry.kind);
+        }
+    }
+
+    // Calls visit(j) for every reference node i holds to node j. An array
+    // buffer seen for the first time becomes a node (and is held) here.
+    auto forEachChild = [&](size_t i, auto&& visit) {
+        auto edge = [&](const Value& v) {
+            const void* child = referentOf(v);
+            if (!child) return;
+            auto it = index.find(child);
+            if (it != index.end()) {
+                visit(it->second);
+            } else if (auto array = std::get_if<Array>(&v.data)) {
+                index.emplace(child, held.size());
+                held.push_back(array->buffer);
+                kinds.push_back(Kind::BUFFER);
+                visit(held.size() - 1);
+            }
+        };
+        const void* node = held[i].get();
+        if (kinds[i] == Kind::MAP) {
+            static_cast<const Map*>(node)->forEachValue(edge);
+        } else {
+            const auto& items = kinds[i] == Kind::BUFFER ? static_cast<const ArrayBuffer*>(node)->items
+                                                         : *static_cast<const std::vector<Value>*>(node);
+            for (const Value& v : items) edge(v);
+        }
+    };
+
+    // 1. Outside references = use count - our hold - references from
+    //    other nodes. Walking every node also finds the buffers.
+    std::vector<long> inside;
+    for (size_t i = 0; i < held.size(); i++) {
+        forEachChild(i, [&](size_t j) {
+            if (j >= inside.size()) inside.resize(j + 1, 0);
+            inside[j]++;
+        });
+    }
+    inside.resize(held.size(), 0);
+    std::vector<long> outside(held.size());
+    for (size_t i = 0; i < held.size(); i++) outside[i] = held[i].use_count() - 1 - inside[i];
+
+    // 2. Everything reachable from a node with outside references lives
+    std::vector<char> live(held.size(), 0);
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < held.size(); i++) {
+        if (outside[i] > 0) {
+            live[i] = 1;
+            pending.push_back(i);
+        }
+    }
+    while (!pending.empty()) {
+        size_t i = pending.back();
+        pending.pop_back();
+        forEachChild(i, [&](size_t j) {
+            if (!live[j]) {
+                live[j] = 1;
+                pending.push_back(j);
+            }
+        });
+    }
+
+    // 3. Empty the garbage. The elements are moved out first and destroyed
+    //    after the pass, so no destructor runs while we walk the graph.
+    std::vector<std::vector<Value>> doomed;
+    std::vector<Map> doomedMaps;
+    size_t freedBytes = 0, liveBytes = 0;
+    tracked.clear();
+    for (size_t i = 0; i < held.size(); i++) {
+        // A garbage buffer goes when the collections holding it are emptied
+        if (kinds[i] == Kind::BUFFER) continue;
+        if (kinds[i] == Kind::MAP) {
+            Map& map = *static_cast<Map*>(held[i].get());
+            if (live[i]) {
+                liveBytes += footprint(map);
+                tracked.push_back({held[i], Kind::MAP});
+            } else {
+                freedBytes += footprint(map);
+                doomedMaps.push_back(std::move(map));
+                map = Map();
+            }
+            continue;
+        }
+        auto& list = *static_cast<std::vector<Value>*>(held[i].get());
+        if (live[i]) {
+            liveBytes += footprint(list);
+            tracked.push_back({held[i], Kind::LIST});
+        } else {
+            freedBytes += footprint(list);
+            doomed.emplace_back(std::move(list));
+            list.clear();
+        }
+    }
+    size_t freed = doomed.size() + doomedMaps.size();
+    doomed.clear();
+    doomedMaps.clear();
+    held.clear();
+
+    // Like a GC heap target: the next run waits until as much again as is
+    // live now has been allocated, so the cost per byte stays constant
+    trigger = std::max(minTrigger.load(std::memory_order_relaxed), liveBytes);
+
+    unsigned long long ns = (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    runs.fetch_add(1, std::memory_order_relaxed);
+    reclaimedCollections.fetch_add(freed, std::memory_order_relaxed);
+    reclaimedBytes.fetch_add(freedBytes, std::memory_order_relaxed);
+    pauseNsTotal.fetch_add(ns, std::memory_order_relaxed);
+    unsigned long long seen = pauseNsMax.load(std::memory_order_relaxed);
+    while (ns > seen && !pauseNsMax.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {}
+    return freed;
+}
+
+void CycleCollector::reportAtExit() {
+    std::atexit([] {
+        unsigned long long n = runs.load();
+        char line[256];
+        std::snprintf(line, sizeof(line),
+                      "drim gc: %llu runs (%llu skipped while threads were active), reclaimed %llu collections / %.1f KiB, "
+                      "pause total %.3f ms, max %.3f ms, mean %.3f ms\n",
+                      n, skipped.load(), reclaimedCollections.load(), reclaimedBytes.load() / 1024.0,
+                      pauseNsTotal.load() / 1e6, pauseNsMax.load() / 1e6, n ? pauseNsTotal.load() / 1e6 / n : 0.0);
+        std::cerr << line;
+    });
+}
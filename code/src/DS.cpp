@@ -1,59 +1,171 @@
 #include "../include/DS.h"
+#include "../include/Error.h"
+#include "../include/Collector.h"
+#include "../include/Map.h"
 #include <iostream>
 #include <vector>
 #include <memory>
 
+// The size hint of map_create / map_reserve
+static size_t expectedKeys(const std::string& name, const Value& hint) {
+    auto n = std::get_if<long long>(&hint.data);
+    if (!n || *n < 0) {
+        std::cerr << "Runtime Error: " << name << " expects a key count that is a non-negative int.\n";
+        drimExit(1);
+    }
+    if ((unsigned long long)*n > Map::MAX_KEYS) {
+        std::cerr << "Runtime Error: " << name << " size hint " << *n << " is more keys than a map can hold ("
+                  << Map::MAX_KEYS << ").\n";
+        drimExit(1);
+    }
+    return (size_t)*n;
+}
+
+static Value mapKey(const std::string& name, const Value& key) {
+    Value normalized;
+    if (!Map::normalizeKey(key, normalized)) {
+        std::cerr << "Runtime Error: " << name << " keys must be ints or strings";
+        if (std::holds_alternative<DrimFloat>(key.data)) std::cerr << " (a float key must be a whole number)";
+        std::cerr << ".\n";
+        drimExit(1);
+    }
+    return normalized;
+}
+
+static Value execMap(const std::string& name, const Value* args, size_t count) {
+    if (name == "map_create") {
+        if (count > 1) { std::cerr << "Runtime Error: map_create() expects at most 1 arg (a size hint).\n"; drimExit(1); }
+        auto map = std::make_shared<Map>();
+        CycleCollector::forThread().track(map);
+        if (count == 1) map->reserve(expectedKeys(name, args[0]));
+        return Value(std::move(map));
+    }
+
+    auto mapPtr = count >= 1 ? std::get_if<std::shared_ptr<Map>>(&args[0].data) : nullptr;
+    if (!mapPtr) {
+        std::cerr << "Runtime Error: First argument of '" << name << "' must be a map.\n";
+        drimExit(1);
+    }
+    Map& map = **mapPtr;
+
+    if (name == "map_set") {
+        if (count != 3) { std::cerr << "Runtime Error: map_set(m, key, val) expects 3 args.\n"; drimExit(1); }
+        size_t before = map.size();
+        map.set(mapKey(name, args[1]), args[2]);
+        if (map.size() != before) CycleCollector::forThread().noteAllocation(2 * sizeof(Value));
+        return args[2];
+    }
+    if (name == "map_get") {
+        if (count != 2 && count != 3) {
+            std::cerr << "Runtime Error: map_get(m, key) expects 2 args, or 3 with a default.\n";
+            drimExit(1);
+        }
+        Value key = mapKey(name, args[1]);
+        if (const Value* found = map.find(key)) return *found;
+        if (count == 3) return args[2];
+        std::cerr << "Runtime Error: map_get found no key ";
+        if (auto s = std::get_if<std::string>(&key.data)) std::cerr << "'" << *s << "'";
+        else std::cerr << std::get<long long>(key.data);
+        std::cerr << " in the map.\n";
+        drimExit(1);
+    }
+    if (name == "map_has") {
+        if (count != 2) { std::cerr << "Runtime Error: map_has(m, key) expects 2 args.\n"; drimExit(1); }
+        return (bool)(map.find(mapKey(name, args[1])) != nullptr);
+    }
+    if (name == "map_remove") {
+        if (count != 2) { std::cerr << "Runtime Error: map_remove(m, key) expects 2 args.\n"; drimExit(1); }
+        return (bool)map.remove(mapKey(name, args[1]));
+    }
+    if (name == "map_size") {
+        return (long long)map.size();
+    }
+    if (name == "map_keys") {
+        std::vector<Value> keys = map.keys();
+        Array arr{std::make_shared<ArrayBuffer>()};
+        arr.length = keys.size();
+        // A map with both int and string keys gives an array of no fixed element type
+        for (const Value& key : keys) {
+            std::string type = std::holds_alternative<long long>(key.data) ? "int" : "string";
+            if (arr.buffer->elementType.empty()) arr.buffer->elementType = type;
+            else if (arr.buffer->elementType != type) { arr.buffer->elementType.clear(); break; }
+        }
+        arr.buffer->items = std::move(keys);
+        return arr;
+    }
+    if (name == "map_reserve") {
+        if (count != 2) { std::cerr << "Runtime Error: map_reserve(m, n) expects 2 args.\n"; drimExit(1); }
+        map.reserve(expectedKeys(name, args[1]));
+        return (long long)map.size();
+    }
+
+    std::cerr << "Runtime Error: Unknown DS function '" << name << "'\n";
+    drimExit(1);
+}
+
 Value execDS(const std::string& name, const Value* args, size_t count) {
     // === 1. CREATION ===
     if (name == "stack_create" || name == "queue_create") {
         auto collectionPtr = std::make_shared<std::vector<Value>>();
+        CycleCollector::forThread().track(collectionPtr);
+        if (MemStats::enabled()) MemStats::trackCollection(collectionPtr);
         return Value(collectionPtr);
     }
 
+    if (name.compare(0, 4, "map_") == 0) return execMap(name, args, count);
+
+    if (name == "array_size") {
+        auto arr = count == 1 ? std::get_if<Array>(&args[0].data) : nullptr;
+        if (!arr) { std::cerr << "Runtime Error: array_size(a) expects an array.\n"; drimExit(1); }
+        return (long long)arr->size();
+    }
+
     // All other operations require at least 1 argument (the collection)
     if (count < 1) {
         std::cerr << "Runtime Error: '" << name << "' expects at least 1 argument.\n";
-        exit(1);
+        drimExit(1);
     }
 
     auto variantPtr = std::get_if<std::shared_ptr<std::vector<Value>>>(&args[0].data);
     if (!variantPtr) {
         std::cerr << "Runtime Error: First argument of '" << name << "' must be a collection.\n";
-        exit(1);
+        drimExit(1);
     }
     auto& list = *variantPtr;
 
     // === 2. STACK OPERATIONS (LIFO) ===
     if (name == "stack_push") {
-        if (count != 2) { std::cerr << "Runtime Error: stack_push(s, val) expects 2 args.\n"; exit(1); }
+        if (count != 2) { std::cerr << "Runtime Error: stack_push(s, val) expects 2 args.\n"; drimExit(1); }
         list->push_back(args[1]);
+        CycleCollector::forThread().noteAllocation(sizeof(Value));
         return args[1];
     }
     if (name == "stack_pop") {
-        if (list->empty()) { std::cerr << "Runtime Error: stack_pop from empty stack.\n"; exit(1); }
+        if (list->empty()) { std::cerr << "Runtime Error: stack_pop from empty stack.\n"; drimExit(1); }
         Value top = list->back();
         list->pop_back();
         return top;
     }
     if (name == "stack_peek") {
-        if (list->empty()) { std::cerr << "Runtime Error: stack_peek at empty stack.\n"; exit(1); }
+        if (list->empty()) { std::cerr << "Runtime Error: stack_peek at empty stack.\n"; drimExit(1); }
         return list->back();
     }
 
     // === 3. QUEUE OPERATIONS (FIFO) ===
     if (name == "queue_enqueue") {
-        if (count != 2) { std::cerr << "Runtime Error: queue_enqueue(q, val) expects 2 args.\n"; exit(1); }
+        if (count != 2) { std::cerr << "Runtime Error: queue_enqueue(q, val) expects 2 args.\n"; drimExit(1); }
         list->push_back(args[1]); // Enqueue at the end
+        CycleCollector::forThread().noteAllocation(sizeof(Value));
         return args[1];
     }
     if (name == "queue_dequeue") {
-        if (list->empty()) { std::cerr << "Runtime Error: queue_dequeue from empty queue.\n"; exit(1); }
+        if (list->empty()) { std::cerr << "Runtime Error: queue_dequeue from empty queue.\n"; drimExit(1); }
         Value front = list->front();
         list->erase(list->begin()); // Traditional way to remove from front of a vector
         return front;
     }
     if (name == "queue_peek") {
-        if (list->empty()) { std::cerr << "Runtime Error: queue_peek at empty queue.\n"; exit(1); }
+        if (list->empty()) { std::cerr << "Runtime Error: queue_peek at empty queue.\n"; drimExit(1); }
         return list->front();
     }
 
@@ -66,5 +178,5 @@ Value execDS(const std::string& name, const Value* args, size_t count) {
     }
 
     std::cerr << "Runtime Error: Unknown DS function '" << name << "'\n";
-    exit(1);
+    drimExit(1);
 }
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "../include/Drim.h"
+#include "../include/Lexer.h"
+#include "../include/Parser.h"
+#include "../include/Interpreter.h"
+#include "../include/Output.h"
+#include "../include/Input.h"
+#include "../include/Error.h"
+#include "../include/Signal.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+std::string valToString(const Value& v); // Interpreter.cpp
+
+namespace drim {
+
+struct Program::Impl {
+    std::string source;
+    std::vector<std::shared_ptr<Stmt>> commands;
+};
+
+// Everything a run touches that is per thread: drimExit throws instead of
+// exiting, and stdout/stderr/stdin are redirected to the run's strings.
+// The previous settings come back afterwards, so a host function may
+// compile or run other programs while a run is in progress.
+struct Isolation {
+    bool throwed;
+    std::string* out;
+    std::string* err;
+    const OutputBuffer::Drain* drain;
+    InputBuffer* in;
+
+    Isolation(std::string* runOut, std::string* runErr, InputBuffer* runIn,
+              const OutputBuffer::Drain* runDrain = nullptr)
+        : throwed(throwsOnExit()), drain(OutputBuffer::drainedThread()), in(InputBuffer::usedForThread()) {
+        OutputBuffer::capturedThread(out, err);
+        setThrowOnExit(true);
+        OutputBuffer::captureThread(runOut, runErr);
+        OutputBuffer::drainThread(runDrain);
+        InputBuffer::useForThread(runIn);
+    }
+    ~Isolation() {
+        setThrowOnExit(throwed);
+        OutputBuffer::captureThread(out, err);
+        OutputBuffer::drainThread(drain);
+        InputBuffer::useForThread(in);
+    }
+};
+
+// Passes streamed output on in chunks (see Instance::streamOutput). Error
+// messages go whole lines at a time; std::cerr flushes std::cout before
+// each write, so they never overtake the output printed before them.
+struct Streamer {
+    static const size_t CHUNK = 4096;
+
+    const OutputSink& sink;
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+
+    void operator()(std::string& text, bool isError, bool flush) {
+        if (text.empty()) return;
+        if (isError) {
+            if (text.back() != '\n') return;
+        } else if (!flush && text.size() < CHUNK) {
+            if (text.back() != '\n') return;
+            if (std::chrono::steady_clock::now() - last < std::chrono::milliseconds(20)) return;
+        }
+        pass(text, isError);
+    }
+
+    void pass(std::string& text, bool isError) {
+        if (text.empty()) return;
+        sink(text, isError);
+        text.clear();
+        last = std::chrono::steady_clock::now();
+    }
+};
+
+static ::Value toInternal(const Value& v) {
+    switch (v.type()) {
+        case Value::INT:    return ::Value(v.asInt());
+        case Value::FLOAT:  return ::Value((DrimFloat)v.asFloat());
+        case Value::BOOL:   return ::Value(v.asBool());
+        default:            return ::Value(v.asString());
+    }
+}
+
+static Value toHost(const ::Value& v) {
+    if (auto i = std::get_if<long long>(&v.data)) return Value(*i);
+    if (auto d = std::get_if<DrimFloat>(&v.data)) return Value(*d);
+    if (auto s = std::get_if<std::string>(&v.data)) return Value(*s);
+    if (auto b = std::get_if<bool>(&v.data)) return Value(*b);
+    if (std::holds_alternative<std::shared_ptr<Task>>(v.data)) return Value::other("<task>");
+    if (std::holds_alternative<Array>(v.data)) return Value::other(::valToString(v));
+    if (std::holds_alternative<std::shared_ptr<Map>>(v.data)) return Value::other("<map>");
+    return Value::other("<collection>");
+}
+
+Program::Program() : state(new Impl()) {}
+Program::~Program() = default;
+
+std::shared_ptr<const Program> Program::compile(const std::string& source, std::string* error) {
+    std::shared_ptr<Program> program(new Program());
+    program->state->source = source;
+
+    std::string messages;
+    int status = 0;
+    {
+        Isolation isolated(nullptr, &messages, InputBuffer::usedForThread());
+        try {
+            Lexer lexer(program->state->source);
+            lexer.scanTokens();
+            Parser parser(lexer.tokens);
+            program->state->commands = parser.parse();
+        } catch (ScriptExit& e) {
+            status = e.status;
+        }
+    }
+
+    if (status != 0) {
+        if (error) *error = messages;
+        return nullptr;
+    }
+    return program;
+}
+
+std::shared_ptr<const Program> Program::compileFile(const std::string& path, std::string* error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        if (error) *error = "Error: Could not open file '" + path + "'\n";
+        return nullptr;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return compile(buffer.str(), error);
+}
+
+struct Instance::Impl {
+    std::shared_ptr<const Program> program;
+    Interpreter interpreter;
+    std::unordered_map<std::string, Function> functions;
+    std::unique_ptr<InputBuffer> input = InputBuffer::fromText("");
+    std::string inputText;
+    OutputSink sink;
+    bool callHost(const std::string& name, const ::Value* args, size_t count, ::Value& result) {
+        auto it = functions.find(name);
+        if (it == functions.end()) return false;
+        std::vector<Value> converted;
+        converted.reserve(count);
+        for (size_t i = 0; i < count; i++) converted.push_back(toHost(args[i]));
+        result = toInternal(it->second(converted));
+        return true;
+    }
+};
+
+Instance::Instance(std::shared_ptr<const Program> program) : state(new Impl()) {
+    state->program = std::move(program);
+}
+
+Instance::~Instance() = default;
+
+void Instance::set(const std::string& name, const Value& value) {
+    state->interpreter.globals().define(name, toInternal(value));
+}
+
+Value Instance::get(const std::string& name) const {
+    Scope& globals = state->interpreter.globals();
+    if (!globals.contains(name)) return Value::other("");
+    return toHost(globals.get({TOKEN_IDENTIFIER, name, 0}));
+}
+
+void Instance::bind(const std::string& name, Function fn) {
+    bool first = state->functions.empty();
+    state->functions[name] = std::move(fn);
+    if (first) {
+        Impl* impl = state.get();
+        state->interpreter.setHostCall([impl](const std::string& n, const ::Value* args, size_t count, ::Value& result) {
+            return impl->callHost(n, args, count, result);
+        });
+    }
+}
+
+void Instance::setInput(const std::string& text) {
+    state->inputText = text;
+}
+
+void Instance::streamOutput(OutputSink sink) {
+    state->sink = std::move(sink);
+}
+
+Result Instance::run() {
+    Result result;
+    state->input->replay(state->inputText);
+    Streamer streamer{state->sink};
+    OutputBuffer::Drain drain = std::ref(streamer);
+    {
+        Isolation isolated(&result.output, &result.error, state->input.get(), state->sink ? &drain : nullptr);
+        try {
+            state->interpreter.interpret(state->program->state->commands);
+        } catch (ReturnValue&) {
+        } catch (BreakSignal&) {
+        } catch (ContinueSignal&) {
+        } catch (ScriptExit& e) {
+            result.status = e.status;
+        }
+    }
+    if (state->sink) {
+        streamer.pass(result.output, false);
+        streamer.pass(result.error, true);
+    }
+    return result;
+}
+
+void Instance::reset() {
+    state->interpreter.reset();
+}
+
+}
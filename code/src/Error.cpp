@@ -0,0 +1,17 @@
+#include "../include/Error.h"
+#include <cstdlib>
+
+static thread_local bool throwOnExit = false;
+
+void drimExit(int status) {
+    if (throwOnExit) throw ScriptExit{status};
+    std::exit(status);
+}
+
+void setThrowOnExit(bool on) {
+    throwOnExit = on;
+}
+
+bool throwsOnExit() {
+    return throwOnExit;
+}
@@ -0,0 +1,157 @@
+#include "../include/Input.h"
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define DRIM_POSIX_IO 1
+#else
+#define DRIM_POSIX_IO 0
+#endif
+
+static thread_local InputBuffer* threadInput = nullptr;
+
+InputBuffer& InputBuffer::instance() {
+    if (threadInput) return *threadInput;
+    static InputBuffer buf;
+    return buf;
+}
+
+std::unique_ptr<InputBuffer> InputBuffer::fromText(const std::string& text) {
+    std::unique_ptr<InputBuffer> in(new InputBuffer());
+    in->replay(text);
+    return in;
+}
+
+void InputBuffer::useForThread(InputBuffer* own) {
+    threadInput = own;
+}
+
+InputBuffer* InputBuffer::usedForThread() {
+    return threadInput;
+}
+
+void InputBuffer::open() {
+    opened = true;
+#if DRIM_POSIX_IO
+    struct stat st;
+    if (fstat(STDIN_FILENO, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        off_t offset = lseek(STDIN_FILENO, 0, SEEK_CUR);
+        if (offset < 0) offset = 0;
+        void* mem = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+        if (mem != MAP_FAILED) {
+            mapped = static_cast<const char*>(mem);
+            mappedSize = (size_t)st.st_size;
+            begin = (size_t)offset < mappedSize ? (size_t)offset : mappedSize;
+            end = mappedSize;
+            eof = true;
+            return;
+        }
+    }
+#endif
+    chunk.resize(1 << 16);
+}
+
+void InputBuffer::replay(const std::string& text) {
+    if (&text != &replayed) replayed = text;
+    opened = true;
+    mapped = replayed.data();
+    mappedSize = replayed.size();
+    begin = 0;
+    end = mappedSize;
+    eof = true;
+}
+
+// Pulls more bytes into the chunk buffer, keeping the unread tail
+bool InputBuffer::fill() {
+    if (eof) return false;
+    if (begin > 0) {
+        std::memmove(chunk.data(), chunk.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+    }
+    if (end == chunk.size()) chunk.resize(chunk.size() * 2);
+
+#if DRIM_POSIX_IO
+    ssize_t n;
+    do {
+        n = ::read(STDIN_FILENO, chunk.data() + end, chunk.size() - end);
+    } while (n < 0 && errno == EINTR);
+#else
+    long n = (long)std::fread(chunk.data() + end, 1, chunk.size() - end, stdin);
+#endif
+    if (n <= 0) {
+        eof = true;
+        return false;
+    }
+    end += (size_t)n;
+    return true;
+}
+
+bool InputBuffer::readLine(std::string_view& line) {
+    if (!opened) open();
+    const char* base = mapped ? mapped : chunk.data();
+
+    size_t scanFrom = begin;
+    while (true) {
+        const void* nl = std::memchr(base + scanFrom, '\n', end - scanFrom);
+        if (nl) {
+            size_t at = static_cast<const char*>(nl) - base;
+            line = std::string_view(base + begin, at - begin);
+            begin = at + 1;
+            return true;
+        }
+        scanFrom = end;
+        size_t consumed = begin;
+        if (!fill()) break;
+        base = chunk.data();
+        scanFrom -= consumed;
+    }
+
+    // Last line without a trailing newline
+    if (begin == end) return false;
+    line = std::string_view(base + begin, end - begin);
+    begin = end;
+    return true;
+}
+
+// Accepts an optional leading '-', digits and at most one '.'; anything else
+// (including out-of-range numbers) stays a string.
+Value parseInput(std::string_view text) {
+    if (text.empty()) return std::string(text);
+
+    size_t i = 0;
+    // Check for a leading negative sign, but ensure there's a character after it
+    if (text[0] == '-' && text.size() > 1) i = 1;
+
+    bool hasDot = false;
+    bool hasDigit = false;
+    for (; i < text.size(); ++i) {
+        char c = text[i];
+        if (c >= '0' && c <= '9') {
+            hasDigit = true;
+        } else if (c == '.' && !hasDot) {
+            hasDot = true;
+        } else {
+            return std::string(text);
+        }
+    }
+    if (!hasDigit) return std::string(text);
+
+    const char* first = text.data();
+    const char* last = first + text.size();
+    if (hasDot) {
+        DrimFloat d;
+        auto res = std::from_chars(first, last, d);
+        if (res.ec == std::errc() && res.ptr == last) return d;
+    } else {
+        long long n;
+        auto res = std::from_chars(first, last, n);
+        if (res.ec == std::errc() && res.ptr == last) return n;
+    }
+    return std::string(text);
+}
@@ -2,10 +2,16 @@
 #include "../include/Physics.h"
 #include "../include/DS.h"
 #include "../include/Signal.h"
+#include "../include/Error.h"
+#include "../include/Input.h"
+#include "../include/Parallel.h"
+#include "../include/Output.h"
 #include <iostream>
 #include <string>
 #include <cmath>
 #include <variant>
+#include <algorithm>
+#include <limits>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846L
@@ -14,140 +20,347 @@
 bool isTruthy(const Value& v) {
     if (auto b = std::get_if<bool>(&v.data)) return *b;
     if (auto i = std::get_if<long long>(&v.data)) return *i != 0;
-    if (auto d = std::get_if<long double>(&v.data)) return *d != 0.0L;
+    if (auto d = std::get_if<DrimFloat>(&v.data)) return *d != 0;
     if (auto s = std::get_if<std::string>(&v.data)) return !s->empty();
     return false;
 }
 
-// Stricter version of parseInput as discussed
-Value parseInput(std::string text) {
-    if (text.empty()) return text;
+DrimFloat getFloat(const Value& v) {
+    if (auto i = std::get_if<long long>(&v.data)) return (DrimFloat)*i;
+    if (auto d = std::get_if<DrimFloat>(&v.data)) return *d;
+    return 0;
+}
 
-    size_t i = 0;
-    // Check for a leading negative sign, but ensure there's a character after it
-    if (text[0] == '-' && text.size() > 1) i = 1;
+// Appends the text form of a value (as used by + and interpolation)
+void appendValue(std::string& out, const Value& v) {
+    if (auto i = std::get_if<long long>(&v.data)) {
+        char digits[24];
+        auto res = std::to_chars(digits, digits + sizeof(digits), *i);
+        out.append(digits, res.ptr - digits);
+    }
+    else if (auto d = std::get_if<DrimFloat>(&v.data)) out += std::to_string(*d);
+    else if (auto b = std::get_if<bool>(&v.data)) out += *b ? "true" : "false";
+    else if (auto s = std::get_if<std::string>(&v.data)) out += *s;
+    else if (std::holds_alternative<std::shared_ptr<Task>>(v.data)) out += "<task>";
+    else if (std::holds_alternative<std::shared_ptr<Map>>(v.data)) out += "<map>";
+    else if (auto a = std::get_if<Array>(&v.data)) {
+        out += '[';
+        for (size_t i = 0; i < a->size(); i++) {
+            if (i) out += ", ";
+            appendValue(out, (*a)[i]);
+        }
+        out += ']';
+    }
+    else out += "<collection>";
+}
 
-    bool isNumber = true;
-    bool hasDot = false;
-    bool hasDigit = false;
+// Helper to convert Value to String
+std::string valToString(const Value& v) {
+    if (auto s = std::get_if<std::string>(&v.data)) return *s;
+    std::string text;
+    appendValue(text, v);
+    return text;
+}
 
-    for (; i < text.size(); ++i) {
-        if (isdigit(text[i])) {
-            hasDigit = true;
-        } else if (text[i] == '.' && !hasDot) {
-            hasDot = true;
-        } else {
-            isNumber = false;
-            break;
-        }
+// True if evaluating `expr` only reads variables, so a reference read
+// before it is still good afterwards
+static bool isPlainRead(const Expr* expr) {
+    if (dynamic_cast<const VariableExpr*>(expr) || dynamic_cast<const LiteralExpr*>(expr)) return true;
+    if (dynamic_cast<const HoistedExpr*>(expr)) return true;
+    if (auto access = dynamic_cast<const ArrayAccessExpr*>(expr)) return isPlainRead(access->index.get());
+    if (auto bin = dynamic_cast<const BinaryExpr*>(expr)) {
+        return isPlainRead(bin->left.get()) && isPlainRead(bin->right.get());
     }
+    if (auto una = dynamic_cast<const UnaryExpr*>(expr)) return isPlainRead(una->right.get());
+    return false;
+}
 
-    if (isNumber && hasDigit) {
-        try {
-            if (hasDot) return std::stold(text); // 64-bit float
-            return std::stoll(text);            // 64-bit integer
-        } catch (...) {
-            return text;
-        }
+// Applies a numeric operator to two ints. False if ints do not support it.
+static bool intOperation(TokenType op, long long l, long long r, Value& out) {
+    switch (op) {
+        case TOKEN_PLUS:          out = Value(l + r); return true;
+        case TOKEN_MINUS:         out = Value(l - r); return true;
+        case TOKEN_STAR:          out = Value(l * r); return true;
+        case TOKEN_SLASH:
+            if (r == 0) { std::cerr << "Runtime Error: Division by zero\n"; drimExit(1); }
+            out = Value(l / r);
+            return true;
+        case TOKEN_MOD:
+            if (r == 0) { std::cerr << "Runtime Error: Modulo by zero\n"; drimExit(1); }
+            out = Value(l % r);
+            return true;
+        case TOKEN_POW:           out = Value((DrimFloat)std::pow((DrimFloat)l, (DrimFloat)r)); return true;
+        case TOKEN_BIT_AND:       out = Value(l & r); return true;
+        case TOKEN_BIT_OR:        out = Value(l | r); return true;
+        case TOKEN_LSHIFT:        out = Value(l << r); return true;
+        case TOKEN_RSHIFT:        out = Value(l >> r); return true;
+        case TOKEN_LESS:          out = Value(l < r); return true;
+        case TOKEN_GREATER:       out = Value(l > r); return true;
+        case TOKEN_LESS_EQUAL:    out = Value(l <= r); return true;
+        case TOKEN_GREATER_EQUAL: out = Value(l >= r); return true;
+        case TOKEN_EQUAL_EQUAL:   out = Value(l == r); return true;
+        case TOKEN_BANG_EQUAL:    out = Value(l != r); return true;
+        default: return false;
     }
-    return text;
 }
 
-long double getLongDouble(const Value& v) {
-    if (auto i = std::get_if<long long>(&v.data)) return (long double)*i;
-    if (auto d = std::get_if<long double>(&v.data)) return *d;
-    return 0.0L;
+// Applies a numeric operator to two floats. False if floats do not support it.
+static bool floatOperation(TokenType op, DrimFloat l, DrimFloat r, Value& out) {
+    switch (op) {
+        case TOKEN_PLUS:          out = Value(l + r); return true;
+        case TOKEN_MINUS:         out = Value(l - r); return true;
+        case TOKEN_STAR:          out = Value(l * r); return true;
+        case TOKEN_SLASH:
+            if (r == 0) { std::cerr << "Runtime Error: Division by zero\n"; drimExit(1); }
+            out = Value(l / r);
+            return true;
+        case TOKEN_MOD:
+            if (r == 0) { std::cerr << "Runtime Error: Modulo by zero\n"; drimExit(1); }
+            out = Value((DrimFloat)std::fmod(l, r));
+            return true;
+        case TOKEN_POW:           out = Value((DrimFloat)std::pow(l, r)); return true;
+        case TOKEN_LESS:          out = Value(l < r); return true;
+        case TOKEN_GREATER:       out = Value(l > r); return true;
+        case TOKEN_LESS_EQUAL:    out = Value(l <= r); return true;
+        case TOKEN_GREATER_EQUAL: out = Value(l >= r); return true;
+        case TOKEN_EQUAL_EQUAL:   out = Value(l == r); return true;
+        case TOKEN_BANG_EQUAL:    out = Value(l != r); return true;
+        default: return false;
+    }
 }
 
-// Helper to convert Value to String
-std::string valToString(const Value& v) {
-    if (auto i = std::get_if<long long>(&v.data)) return std::to_string(*i);
-    if (auto d = std::get_if<long double>(&v.data)) return std::to_string(*d);
-    if (auto b = std::get_if<bool>(&v.data)) return *b ? "true" : "false";
-    if (auto s = std::get_if<std::string>(&v.data)) return *s;
-    return "<collection>";
+Interpreter::Interpreter() : tracer(Tracer::active()) {
+    scope = std::make_shared<Scope>();
+    argStack.reserve(64);
 }
 
-Interpreter::Interpreter() {
+void Interpreter::reset() {
     scope = std::make_shared<Scope>();
+    argStack.clear();
+}
+
+void Interpreter::enableJit(int threshold) {
+    jit = std::make_unique<Jit>(threshold);
+}
+
+const Value& Interpreter::read(const std::shared_ptr<Expr>& expr, Value& scratch) {
+    Expr* raw = expr.get();
+    if (auto var = dynamic_cast<VariableExpr*>(raw)) {
+        return scope->lookup(var->name);
+    }
+    if (auto access = dynamic_cast<ArrayAccessExpr*>(raw)) {
+        int index = (int)getFloat(read(access->index, scratch));
+        return scope->getArrayElement(access->name, index);
+    }
+    if (auto lit = dynamic_cast<LiteralExpr*>(raw)) {
+        // Strings with {name} or escapes are built fresh every time
+        auto s = std::get_if<std::string>(&lit->value.data);
+        if (!s || s->find_first_of("{\\") == std::string::npos) return lit->value;
+    }
+    if (auto hoisted = dynamic_cast<HoistedExpr*>(raw)) {
+        return readHoisted(*hoisted, scratch);
+    }
+    scratch = evaluate(expr);
+    return scratch;
+}
+
+const Value& Interpreter::readHoisted(const HoistedExpr& hoisted, Value& scratch) {
+    // A host function may be bound to a builtin's name and not be pure
+    bool cacheable = !(hostCall && hoisted.callsBuiltin);
+    for (size_t i = hoistFrames.size(); cacheable && i-- > 0;) {
+        if (hoistFrames[i].first != hoisted.loop) continue;
+        size_t slot = hoistFrames[i].second + hoisted.slot;
+        if (!hoistedReady[slot]) {
+            hoistedValues[slot] = evaluate(hoisted.original);
+            hoistedReady[slot] = 1;
+        }
+        return hoistedValues[slot];
+    }
+    // Not inside the loop's run on this interpreter (a parallel worker)
+    return read(hoisted.original, scratch);
+}
+
+// Gives a loop with hoisted expressions fresh slots for one run
+struct HoistFrame {
+    std::deque<Value>& values;
+    std::vector<char>& ready;
+    std::vector<std::pair<const WhileStmt*, size_t>>& frames;
+    bool pushed;
+
+    HoistFrame(std::deque<Value>& v, std::vector<char>& r,
+               std::vector<std::pair<const WhileStmt*, size_t>>& f, const WhileStmt& loop)
+        : values(v), ready(r), frames(f), pushed(loop.hoistedCount > 0) {
+        if (!pushed) return;
+        frames.emplace_back(&loop, values.size());
+        values.resize(values.size() + loop.hoistedCount);
+        ready.resize(values.size(), 0);
+    }
+    ~HoistFrame() {
+        if (!pushed) return;
+        values.resize(frames.back().second);
+        ready.resize(frames.back().second);
+        frames.pop_back();
+    }
+};
+
+// A BinaryExpr whose operands inferTypes proved are both ints or both floats
+Value Interpreter::typedBinary(const BinaryExpr& bin) {
+    Value leftScratch, rightScratch;
+    const Value* left = &read(bin.left, leftScratch);
+    if (left != &leftScratch && !isPlainRead(bin.right.get())) {
+        leftScratch = *left;
+        left = &leftScratch;
+    }
+    const Value& right = read(bin.right, rightScratch);
+    Value result;
+    bool done = bin.operands == OPERANDS_INT
+        ? intOperation(bin.op.type, *std::get_if<long long>(&left->data), *std::get_if<long long>(&right.data), result)
+        : floatOperation(bin.op.type, *std::get_if<DrimFloat>(&left->data), *std::get_if<DrimFloat>(&right.data), result);
+    if (!done) {
+        std::cerr << "Runtime Error: Invalid operation\n";
+        drimExit(1);
+    }
+    return result;
 }
 
-Value Interpreter::evaluate(std::shared_ptr<Expr> expr) {
+Value Interpreter::evaluate(const std::shared_ptr<Expr>& expr) {
+
+    // Proven-type arithmetic skips both the node dispatch below and the
+    // operand type checks. A host function may stand in for a builtin
+    // whose result type the proof relied on.
+    if (auto bin = dynamic_cast<const BinaryExpr*>(expr.get())) {
+        if (bin->operands != OPERANDS_UNKNOWN && !hostCall) return typedBinary(*bin);
+    }
+
+    if (auto hoisted = std::dynamic_pointer_cast<HoistedExpr>(expr)) {
+        Value scratch;
+        return readHoisted(*hoisted, scratch);
+    }
 
     if (auto access = std::dynamic_pointer_cast<ArrayAccessExpr>(expr)) {
-        Value indexVal = evaluate(access->index);
-        long double idxRaw = getLongDouble(indexVal);
-        int index = (int)idxRaw;
+        Value scratch;
+        int index = (int)getFloat(read(access->index, scratch));
         return scope->getArrayElement(access->name, index);
     }
 
+    if (auto slice = std::dynamic_pointer_cast<ArraySliceExpr>(expr)) {
+        long long start = slice->start ? (long long)getFloat(evaluate(slice->start)) : 0;
+        long long end = slice->end ? (long long)getFloat(evaluate(slice->end)) : -1;
+        return scope->getArraySlice(slice->name, start, end);
+    }
+
     if (auto arrLiteral = std::dynamic_pointer_cast<ArrayLiteralExpr>(expr)) {
-        std::cerr << "Runtime Error: Array literal is only valid in assignment\n";
-        exit(1);
+        std::vector<Value> elements;
+        {
+            MemTag tag(MEM_ARRAYS);
+            elements.reserve(arrLiteral->elements.size());
+        }
+        for (const auto& elementExpr : arrLiteral->elements) {
+            elements.push_back(evaluate(elementExpr));
+        }
+        return Scope::makeArray(std::move(elements), "");
     }
 
     // FUNCTION CALLS
     if (auto call = std::dynamic_pointer_cast<CallExpr>(expr)) {
-        std::string funcName;
-        if (auto var = std::dynamic_pointer_cast<VariableExpr>(call->callee)) {
-            funcName = var->name.lexeme;
-        } else {
+        auto var = std::dynamic_pointer_cast<VariableExpr>(call->callee);
+        if (!var) {
              std::cerr << "Runtime Error: Can only call identifiers.\n";
-             exit(1);
+             drimExit(1);
         }
-
-        std::vector<Value> argsValues;
-        for (auto arg : call->arguments) {
-            argsValues.push_back(evaluate(arg));
+        const std::string& funcName = var->name.lexeme;
+
+        // Arguments are evaluated straight onto the shared argument stack.
+        // Nested calls push above our base, so only indices are kept until
+        // every argument has been evaluated.
+        ArgFrame frame(argStack);
+        for (const auto& arg : call->arguments) {
+            Value v = evaluate(arg);
+            argStack.push_back(std::move(v));
         }
+        size_t count = argStack.size() - frame.base;
 
         std::shared_ptr<FunctionStmt> func = scope->getFunc(funcName);
 
         if (func) {
-            if (argsValues.size() != func->params.size()) {
-                std::cerr << "Runtime Error: Expected " << func->params.size() << " arguments but got " << argsValues.size() << ".\n";
-                exit(1);
+            if (count != func->params.size()) {
+                std::cerr << "Runtime Error: Expected " << func->params.size() << " arguments but got " << count << ".\n";
+                drimExit(1);
             }
 
-            auto functionScope = std::make_shared<Scope>(scope);
-            for (size_t i = 0; i < argsValues.size(); i++) {
-                functionScope->define(func->params[i].lexeme, argsValues[i]);
+            Profiler::CallGuard profiled(profiler, func.get());
+            SampleProfiler::CallGuard sampled(sampler, func.get());
+            Tracer::Span traced(tracer, func->name.lexeme.c_str(), "function");
+            step();
+
+            if (jit) {
+                Value result;
+                if (jit->tryCall(func.get(), *scope, argStack.data() + frame.base, count, result)) return result;
+            }
+
+            std::shared_ptr<Scope> functionScope;
+            {
+                MemTag tag(MEM_SCOPES);
+                functionScope = std::make_shared<Scope>(scope);
+            }
+            for (size_t i = 0; i < count; i++) {
+                functionScope->define(func->params[i].lexeme, std::move(argStack[frame.base + i]));
             }
+            frame.release();
 
-            auto previousScope = scope;
-            this->scope = functionScope;
+            ScopeSwap swapped(scope, std::move(functionScope));
 
             Value result = 0LL;
             try {
                 interpret(func->body);
             } catch (ReturnValue& rv) {
-                result = rv.value;
+                result = std::move(rv.value);
             }
-            this->scope = previousScope;
             return result;
         }
 
-        Value args[255];
-        size_t count = 0;
-        for (auto arg : argsValues) {
-            if (count >= 255) {
-                std::cerr << "Runtime Error: Too many arguments.\n";
-                exit(1);
-            }
-            args[count++] = arg;
+        if (count > 255) {
+            std::cerr << "Runtime Error: Too many arguments.\n";
+            drimExit(1);
+        }
+
+        const Value* args = argStack.data() + frame.base;
+
+        if (hostCall) {
+            Value result;
+            if (hostCall(funcName, args, count, result)) return result;
         }
 
-        if (funcName.find("stack_") == 0 || funcName.find("queue_") == 0) {
+        Tracer::Span traced(tracer, funcName.c_str(), "builtin");
+
+        if (funcName.compare(0, 6, "stack_") == 0 || funcName.compare(0, 6, "queue_") == 0 ||
+            funcName.compare(0, 6, "array_") == 0 || funcName.compare(0, 4, "map_") == 0) {
+            MemTag tag(MEM_COLLECTIONS);
+            if (worker) return parallelDS(*worker, funcName, args, count);
             return execDS(funcName, args, count);
         }
 
+        if (funcName == "await") {
+            auto task = count == 1 ? std::get_if<std::shared_ptr<Task>>(&args[0].data) : nullptr;
+            if (!task) {
+                std::cerr << "Runtime Error: await(t) expects a task from spawn.\n";
+                drimExit(1);
+            }
+            return TaskScheduler::instance().await(*task);
+        }
+
         return execPhysics(funcName, args, count);
     }
 
+    if (auto spawn = std::dynamic_pointer_cast<SpawnExpr>(expr)) {
+        return spawnTask(*spawn);
+    }
+
     if (auto lit = std::dynamic_pointer_cast<LiteralExpr>(expr)) {
         if (auto s = std::get_if<std::string>(&lit->value.data)) {
-            std::string text = *s;
-            std::string result = "";
+            const std::string& text = *s;
+            std::string result;
+            result.reserve(text.size());
             size_t start = 0;
 
             while (true) {
@@ -156,7 +369,7 @@ Value Interpreter::evaluate(std::shared_ptr<Expr> expr) {
 
                 if (backslash != std::string::npos &&
                     (openBrace == std::string::npos || backslash < openBrace)) {
-                    result += text.substr(start, backslash - start);
+                    result.append(text, start, backslash - start);
 
                     // Escape Seq
                     if (backslash + 1 < text.length()) {
@@ -174,22 +387,20 @@ Value Interpreter::evaluate(std::shared_ptr<Expr> expr) {
                 }
 
                 if (openBrace == std::string::npos) {
-                    result += text.substr(start);
+                    result.append(text, start, std::string::npos);
                     break;
                 }
 
-                result += text.substr(start, openBrace - start);
+                result.append(text, start, openBrace - start);
                 size_t closeBrace = text.find('}', openBrace);
 
                 if (closeBrace == std::string::npos) {
-                    result += text.substr(openBrace);
+                    result.append(text, openBrace, std::string::npos);
                     break;
                 }
 
-                std::string varName = text.substr(openBrace + 1, closeBrace - openBrace - 1);
-                Token dummyToken = {TOKEN_IDENTIFIER, varName, 0};
-                Value varVal = scope->get(dummyToken);
-                result += valToString(varVal);
+                Token dummyToken = {TOKEN_IDENTIFIER, text.substr(openBrace + 1, closeBrace - openBrace - 1), 0};
+                appendValue(result, scope->lookup(dummyToken));
 
                 start = closeBrace + 1;
             }
@@ -204,81 +415,101 @@ Value Interpreter::evaluate(std::shared_ptr<Expr> expr) {
 
     // UNARY OPERATIONS
     if (auto una = std::dynamic_pointer_cast<UnaryExpr>(expr)) {
-        Value rightVal = evaluate(una->right);
+        Value scratch;
+        const Value& rightVal = read(una->right, scratch);
 
         if (una->op.type == TOKEN_BIT_NOT) {
              if (auto r = std::get_if<long long>(&rightVal.data)) return Value((long long)(~(*r)));
         }
         if (una->op.type == TOKEN_MINUS) {
             if (auto r = std::get_if<long long>(&rightVal.data)) return Value((long long)(-(*r)));
-            if (auto r = std::get_if<long double>(&rightVal.data)) return Value((long double)(-(*r)));
+            if (auto r = std::get_if<DrimFloat>(&rightVal.data)) return Value((DrimFloat)(-(*r)));
         }
         if (una->op.type == TOKEN_BANG) {
             return Value((bool)!isTruthy(rightVal));
         }
 
         std::cerr << "Runtime Error: Invalid unary operation\n";
-        exit(1);
+        drimExit(1);
     }
 
     // CONVERSIONS
     if (auto conv = std::dynamic_pointer_cast<ConvertExpr>(expr)) {
-        Value val = evaluate(conv->value);
-        Value modeVal = evaluate(conv->mode);
+        Tracer::Span traced(tracer, "convert", "builtin");
+        Value scratch;
+        DrimFloat num = getFloat(read(conv->value, scratch));
+        const Value& modeVal = read(conv->mode, scratch);
 
         auto modePtr = std::get_if<std::string>(&modeVal.data);
         if (!modePtr) {
             std::cerr << "Runtime Error: Conversion mode must be a string\n";
-            exit(1);
-        }
-
-        std::string mode = *modePtr;
-        long double num = getLongDouble(val);
-
-        if (mode == "in_cm") return Value((long double)(num * 2.54L));
-        if (mode == "cm_in") return Value((long double)(num / 2.54L));
-        if (mode == "hp_kw") return Value((long double)(num * 0.7457L));
-        if (mode == "kw_hp") return Value((long double)(num / 0.7457L));
-        if (mode == "f_c") return Value((long double)((num - 32.0L) * 5.0L / 9.0L));
-        if (mode == "c_f") return Value((long double)((num * 9.0L / 5.0L) + 32.0L));
-        if (mode == "psi_bar") return Value((long double)(num * 0.0689476L));
-        if (mode == "bar_psi") return Value((long double)(num / 0.0689476L));
-        if (mode == "mb_gb") return Value((long double)(num / 1024.0L));
-        if (mode == "gb_mb") return Value((long double)(num * 1024.0L));
-        if (mode == "j_cal") return Value((long double)(num / 4184.0L));
-        if (mode == "cal_j") return Value((long double)(num * 4184.0L));
-        if (mode == "deg_rad") return Value((long double)(num * (M_PI / 180.0L)));
-        if (mode == "rad_deg") return Value((long double)(num * (180.0L / M_PI)));
-        if (mode == "lb_kg") return Value((long double)(num * 0.453592L));
-        if (mode == "kg_lb") return Value((long double)(num / 0.453592L));
-        if (mode == "usd_bdt") return Value((long double)(num * 122.0L));
-        if (mode == "bdt_usd") return Value((long double)(num / 122.0L));
-        if (mode == "usd_eur") return Value((long double)(num * 0.92L));
-        if (mode == "eur_usd") return Value((long double)(num / 0.92L));
-        if (mode == "mph_kmph") return Value((long double)(num * 1.60934L));
-        if (mode == "kmph_mph") return Value((long double)(num / 1.60934L));
-        if (mode == "nm_ftlb") return Value((long double)(num * 0.737562L));
-        if (mode == "ftlb_nm") return Value((long double)(num / 0.737562L));
-        if (mode == "g_ms2") return Value((long double)(num * 9.80665L));
-        if (mode == "ms2_g") return Value((long double)(num / 9.80665L));
+            drimExit(1);
+        }
+
+        const std::string& mode = *modePtr;
+
+        if (mode == "in_cm") return Value(num * DrimFloat(2.54L));
+        if (mode == "cm_in") return Value(num / DrimFloat(2.54L));
+        if (mode == "hp_kw") return Value(num * DrimFloat(0.7457L));
+        if (mode == "kw_hp") return Value(num / DrimFloat(0.7457L));
+        if (mode == "f_c") return Value((num - DrimFloat(32.0L)) * DrimFloat(5.0L) / DrimFloat(9.0L));
+        if (mode == "c_f") return Value((num * DrimFloat(9.0L) / DrimFloat(5.0L)) + DrimFloat(32.0L));
+        if (mode == "psi_bar") return Value(num * DrimFloat(0.0689476L));
+        if (mode == "bar_psi") return Value(num / DrimFloat(0.0689476L));
+        if (mode == "mb_gb") return Value(num / DrimFloat(1024.0L));
+        if (mode == "gb_mb") return Value(num * DrimFloat(1024.0L));
+        if (mode == "j_cal") return Value(num / DrimFloat(4184.0L));
+        if (mode == "cal_j") return Value(num * DrimFloat(4184.0L));
+        if (mode == "deg_rad") return Value(num * (M_PI / DrimFloat(180.0L)));
+        if (mode == "rad_deg") return Value(num * (DrimFloat(180.0L) / M_PI));
+        if (mode == "lb_kg") return Value(num * DrimFloat(0.453592L));
+        if (mode == "kg_lb") return Value(num / DrimFloat(0.453592L));
+        if (mode == "usd_bdt") return Value(num * DrimFloat(122.0L));
+        if (mode == "bdt_usd") return Value(num / DrimFloat(122.0L));
+        if (mode == "usd_eur") return Value(num * DrimFloat(0.92L));
+        if (mode == "eur_usd") return Value(num / DrimFloat(0.92L));
+        if (mode == "mph_kmph") return Value(num * DrimFloat(1.60934L));
+        if (mode == "kmph_mph") return Value(num / DrimFloat(1.60934L));
+        if (mode == "nm_ftlb") return Value(num * DrimFloat(0.737562L));
+        if (mode == "ftlb_nm") return Value(num / DrimFloat(0.737562L));
+        if (mode == "g_ms2") return Value(num * DrimFloat(9.80665L));
+        if (mode == "ms2_g") return Value(num / DrimFloat(9.80665L));
 
         std::cerr << "Runtime Error: Unknown conversion mode '" << mode << "'\n";
-        exit(1);
+        drimExit(1);
     }
 
     if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
-        Value leftVal = evaluate(bin->left);
-        Value rightVal = evaluate(bin->right);
+        // and / or skip the right side once the left decides the result
+        if (bin->op.type == KW_AND || bin->op.type == KW_OR) {
+            Value scratch;
+            bool left = isTruthy(read(bin->left, scratch));
+            if (left == (bin->op.type == KW_OR)) return Value(left);
+            return Value((bool)isTruthy(read(bin->right, scratch)));
+        }
+
+        Value leftScratch, rightScratch;
+        const Value* left = &read(bin->left, leftScratch);
+        // A call on the right could reassign what `left` refers to
+        if (left != &leftScratch && !isPlainRead(bin->right.get())) {
+            leftScratch = *left;
+            left = &leftScratch;
+        }
+        const Value& leftVal = *left;
+        const Value& rightVal = read(bin->right, rightScratch);
 
-        if (bin->op.type == KW_AND) return Value((bool)(isTruthy(leftVal) && isTruthy(rightVal)));
-        if (bin->op.type == KW_OR) return Value((bool)(isTruthy(leftVal) || isTruthy(rightVal)));
+        // Two ints stay exact even when floats are double
+        Value result;
+        auto li = std::get_if<long long>(&leftVal.data);
+        auto ri = std::get_if<long long>(&rightVal.data);
+        if (li && ri && intOperation(bin->op.type, *li, *ri, result)) return result;
 
-        bool leftIsNum = std::holds_alternative<long long>(leftVal.data) || std::holds_alternative<long double>(leftVal.data);
-        bool rightIsNum = std::holds_alternative<long long>(rightVal.data) || std::holds_alternative<long double>(rightVal.data);
+        bool leftIsNum = std::holds_alternative<long long>(leftVal.data) || std::holds_alternative<DrimFloat>(leftVal.data);
+        bool rightIsNum = std::holds_alternative<long long>(rightVal.data) || std::holds_alternative<DrimFloat>(rightVal.data);
 
-        long double l = 0.0L, r = 0.0L;
-        if (leftIsNum) l = getLongDouble(leftVal);
-        if (rightIsNum) r = getLongDouble(rightVal);
+        DrimFloat l = 0, r = 0;
+        if (leftIsNum) l = getFloat(leftVal);
+        if (rightIsNum) r = getFloat(rightVal);
 
         if (leftIsNum && rightIsNum) {
             switch (bin->op.type) {
@@ -295,34 +526,34 @@ Value Interpreter::evaluate(std::shared_ptr<Expr> expr) {
         if (bin->op.type == TOKEN_BANG_EQUAL) return Value((bool)(leftVal != rightVal));
 
         if (leftIsNum && rightIsNum) {
-            bool useDouble = std::holds_alternative<long double>(leftVal.data) || std::holds_alternative<long double>(rightVal.data);
+            bool useDouble = std::holds_alternative<DrimFloat>(leftVal.data) || std::holds_alternative<DrimFloat>(rightVal.data);
             if (bin->op.type == TOKEN_PLUS) {
-                if(useDouble) return Value((long double)(l + r));
+                if(useDouble) return Value((DrimFloat)(l + r));
                 return Value((long long)((long long)l + (long long)r));
             }
             if (bin->op.type == TOKEN_MINUS) {
-                if(useDouble) return Value((long double)(l - r));
+                if(useDouble) return Value((DrimFloat)(l - r));
                 return Value((long long)((long long)l - (long long)r));
             }
             if (bin->op.type == TOKEN_STAR) {
-                if(useDouble) return Value((long double)(l * r));
+                if(useDouble) return Value((DrimFloat)(l * r));
                 return Value((long long)((long long)l * (long long)r));
             }
             if (bin->op.type == TOKEN_SLASH) {
-                if (r == 0) { std::cerr << "Runtime Error: Division by zero\n"; exit(1); }
-                if(useDouble) return Value((long double)(l / r));
+                if (r == 0) { std::cerr << "Runtime Error: Division by zero\n"; drimExit(1); }
+                if(useDouble) return Value((DrimFloat)(l / r));
                 return Value((long long)((long long)l / (long long)r));
             }
-            if (bin->op.type == TOKEN_POW) return Value((long double)powl(l, r));
+            if (bin->op.type == TOKEN_POW) return Value((DrimFloat)std::pow(l, r));
             if (bin->op.type == TOKEN_MOD) {
                 if (!useDouble) {
                     long long li = (long long)l;
                     long long ri = (long long)r;
-                    if (ri == 0) { std::cerr << "Runtime Error: Modulo by zero\n"; exit(1); }
+                    if (ri == 0) { std::cerr << "Runtime Error: Modulo by zero\n"; drimExit(1); }
                     return Value((long long)(li % ri));
                 }
-                if (r == 0) { std::cerr << "Runtime Error: Modulo by zero\n"; exit(1); }
-                return Value((long double)std::fmod(l, r));
+                if (r == 0) { std::cerr << "Runtime Error: Modulo by zero\n"; drimExit(1); }
+                return Value((DrimFloat)std::fmod(l, r));
             }
 
             if (!useDouble) {
@@ -336,119 +567,225 @@ Value Interpreter::evaluate(std::shared_ptr<Expr> expr) {
         }
 
         if (bin->op.type == TOKEN_PLUS) {
-            auto toStr = [](const Value& v) -> std::string {
-                if (auto i = std::get_if<long long>(&v.data)) return std::to_string(*i);
-                if (auto d = std::get_if<long double>(&v.data)) return std::to_string(*d);
-                if (auto b = std::get_if<bool>(&v.data)) return *b ? "true" : "false";
-                if (auto s = std::get_if<std::string>(&v.data)) return *s;
-                return "<collection>";
-            };
-            return Value(toStr(leftVal) + toStr(rightVal));
+            std::string text;
+            appendValue(text, leftVal);
+            appendValue(text, rightVal);
+            return Value(std::move(text));
         }
 
         std::cerr << "Runtime Error: Invalid operation\n";
-        exit(1);
+        drimExit(1);
     }
 
     return 0LL;
 }
 
-void Interpreter::interpret(std::vector<std::shared_ptr<Stmt>> commands) {
-    for (auto cmd : commands) {
+// The first arm of an else-if jump table whose `subject == constant` test
+// holds, or -1. Mirrors ==: ints match floats of the same value, other
+// types never match an int, and strings match strings only.
+static int findArm(const JumpTable& table, const Value& subject) {
+    if (auto s = std::get_if<std::string>(&subject.data)) {
+        auto it = table.strings.find(*s);
+        return it == table.strings.end() ? -1 : it->second;
+    }
+    if (table.strings.size()) return -1;
+
+    long long key;
+    if (auto i = std::get_if<long long>(&subject.data)) {
+        key = *i;
+    } else if (auto d = std::get_if<DrimFloat>(&subject.data)) {
+        // == converts the constant to a float. Below 2^digits that is exact,
+        // so only the int equal to the subject can match; above it (double
+        // floats past 2^53) several constants may round to the subject, and
+        // the first of them in the chain wins.
+        const DrimFloat exact = std::ldexp(DrimFloat(1), std::numeric_limits<DrimFloat>::digits);
+        if (!(*d > -exact && *d < exact)) {
+            int first = -1;
+            auto consider = [&](long long constant, int arm) {
+                if (arm >= 0 && (DrimFloat)constant == *d && (first < 0 || arm < first)) first = arm;
+            };
+            for (size_t at = 0; at < table.dense.size(); at++) consider(table.low + (long long)at, table.dense[at]);
+            for (const auto& entry : table.ints) consider(entry.first, entry.second);
+            return first;
+        }
+        if (!(*d >= DrimFloat(-9.2233720368547758e18L) && *d < DrimFloat(9.2233720368547758e18L))) return -1;
+        key = (long long)*d;
+        if ((DrimFloat)key != *d) return -1;
+    } else {
+        return -1;
+    }
+
+    if (!table.dense.empty()) {
+        if (key < table.low || (unsigned long long)key - (unsigned long long)table.low >= table.dense.size()) return -1;
+        return table.dense[(size_t)(key - table.low)];
+    }
+    auto it = table.ints.find(key);
+    return it == table.ints.end() ? -1 : it->second;
+}
+
+void Interpreter::interpret(const std::vector<std::shared_ptr<Stmt>>& commands) {
+    // What statements allocate is mostly string contents
+    MemTag values(MEM_STRINGS);
+    for (const auto& cmd : commands) {
         if (!cmd) continue;
+        if (sampler) sampler->setLine(cmd->line);
+        if (values.active) MemStats::setLine(cmd->line);
+        if (profiler) {
+            Profiler::LineGuard guard(*profiler, cmd->line);
+            execute(cmd);
+        } else {
+            execute(cmd);
+        }
+    }
+}
 
-        if (auto whileStmt = std::dynamic_pointer_cast<WhileStmt>(cmd)) {
-            try {
-                while (true) {
-                    Value cond = evaluate(whileStmt->condition);
-                    if (!isTruthy(cond)) break;
-                    try {
-                        std::vector<std::shared_ptr<Stmt>> wrapper = { whileStmt->body };
-                        interpret(wrapper);
-                    } catch (ContinueSignal&) {
-                        continue;
-                    }
+void Interpreter::execute(const std::shared_ptr<Stmt>& cmd) {
+    if (auto whileStmt = std::dynamic_pointer_cast<WhileStmt>(cmd)) {
+        Jit::Region* hot = jit ? jit->loopEntry(whileStmt.get()) : nullptr;
+        HoistFrame hoisted(hoistedValues, hoistedReady, hoistFrames, *whileStmt);
+        try {
+            while (true) {
+                step();
+                if (hot && jit->tryRunLoop(hot, *scope)) break;
+                Value scratch;
+                if (!isTruthy(read(whileStmt->condition, scratch))) break;
+                try {
+                    execute(whileStmt->body);
+                } catch (ContinueSignal&) {
+                    continue;
                 }
-            } catch (BreakSignal&) {
             }
-            continue;
+        } catch (BreakSignal&) {
         }
+        return;
+    }
+
+    if (auto parallel = std::dynamic_pointer_cast<ParallelForStmt>(cmd)) {
+        executeParallel(*parallel);
+        return;
+    }
 
-        if (auto brk = std::dynamic_pointer_cast<BreakStmt>(cmd)) throw BreakSignal();
-        if (auto cont = std::dynamic_pointer_cast<ContinueStmt>(cmd)) throw ContinueSignal();
+    if (auto brk = std::dynamic_pointer_cast<BreakStmt>(cmd)) throw BreakSignal();
+    if (auto cont = std::dynamic_pointer_cast<ContinueStmt>(cmd)) throw ContinueSignal();
 
-        if (auto funcStmt = std::dynamic_pointer_cast<FunctionStmt>(cmd)) {
-            scope->defineFunc(funcStmt->name.lexeme, funcStmt);
-            continue;
-        }
+    if (auto funcStmt = std::dynamic_pointer_cast<FunctionStmt>(cmd)) {
+        scope->defineFunc(funcStmt->name.lexeme, funcStmt);
+        return;
+    }
 
-        if (auto returnStmt = std::dynamic_pointer_cast<ReturnStmt>(cmd)) {
-            Value val = 0LL;
-            if (returnStmt->value) val = evaluate(returnStmt->value);
-            throw ReturnValue(val);
-        }
+    if (auto returnStmt = std::dynamic_pointer_cast<ReturnStmt>(cmd)) {
+        Value val = 0LL;
+        if (returnStmt->value) val = evaluate(returnStmt->value);
+        throw ReturnValue(val);
+    }
 
-        if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(cmd)) {
-            Value cond = evaluate(ifStmt->condition);
-            if (isTruthy(cond)) {
-                interpret({ ifStmt->thenBranch });
-            } else if (ifStmt->elseBranch != nullptr) {
-                interpret({ ifStmt->elseBranch });
-            }
+    if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(cmd)) {
+        if (ifStmt->jumpTable) {
+            const JumpTable& table = *ifStmt->jumpTable;
+            int arm = findArm(table, scope->lookup(table.subject));
+            if (arm >= 0) execute(table.arms[arm]);
+            else if (table.otherwise) execute(table.otherwise);
+            return;
         }
-        else if (auto seq = std::dynamic_pointer_cast<SequenceStmt>(cmd)) {
-            interpret(seq->statements);
-        }
-        else if (auto block = std::dynamic_pointer_cast<BlockStmt>(cmd)) {
-            std::shared_ptr<Scope> previous = scope;
-            scope = std::make_shared<Scope>(previous);
-            interpret(block->statements);
-            scope = previous;
-        }
-        else if (auto input = std::dynamic_pointer_cast<InputStmt>(cmd)) {
-            std::string userText;
-            if (std::getline(std::cin, userText)) {
-                Value parsed = parseInput(userText);
-                if (auto var = std::dynamic_pointer_cast<VariableExpr>(input->target)) {
-                    scope->assign(var->name, parsed);
-                } else if (auto arr = std::dynamic_pointer_cast<ArrayAccessExpr>(input->target)) {
-                    Value indexVal = evaluate(arr->index);
-                    int index = (int)getLongDouble(indexVal);
-                    scope->assignArrayElement(arr->name, index, parsed);
-                }
-            }
+        Value scratch;
+        if (isTruthy(read(ifStmt->condition, scratch))) {
+            execute(ifStmt->thenBranch);
+        } else if (ifStmt->elseBranch != nullptr) {
+            execute(ifStmt->elseBranch);
         }
-        else if (auto assign = std::dynamic_pointer_cast<AssignStmt>(cmd)) {
-            scope->assign(assign->name, evaluate(assign->value));
+    }
+    else if (auto seq = std::dynamic_pointer_cast<SequenceStmt>(cmd)) {
+        interpret(seq->statements);
+    }
+    else if (auto block = std::dynamic_pointer_cast<BlockStmt>(cmd)) {
+        std::shared_ptr<Scope> inner;
+        {
+            MemTag tag(MEM_SCOPES);
+            inner = std::make_shared<Scope>(scope);
         }
-        else if (auto arrDecl = std::dynamic_pointer_cast<ArrayDeclStmt>(cmd)) {
-            scope->declareArray(arrDecl->name);
+        ScopeSwap swapped(scope, std::move(inner));
+        interpret(block->statements);
+    }
+    else if ((worker || inTask) && (std::dynamic_pointer_cast<InputStmt>(cmd) || std::dynamic_pointer_cast<ArrayInputStmt>(cmd))) {
+        std::cerr << "Runtime Error: drim() can only read input on the main thread, not inside "
+                  << (worker ? "drimming parallel" : "a spawned task") << " (line " << cmd->line << ")\n";
+        drimExit(1);
+    }
+    else if (auto input = std::dynamic_pointer_cast<InputStmt>(cmd)) {
+        std::string_view userText;
+        {
+            OutputGuard serialized;
+            std::cout.flush(); // the prompt must be visible before we block
         }
-        else if (auto arrAssign = std::dynamic_pointer_cast<ArrayAssignStmt>(cmd)) {
-            std::vector<Value> elements;
-            for (auto elementExpr : arrAssign->value->elements) {
-                elements.push_back(evaluate(elementExpr));
+        if (InputBuffer::instance().readLine(userText)) {
+            Value parsed = parseInput(userText);
+            if (auto var = std::dynamic_pointer_cast<VariableExpr>(input->target)) {
+                scope->assign(var->name, parsed);
+            } else if (auto arr = std::dynamic_pointer_cast<ArrayAccessExpr>(input->target)) {
+                Value indexVal = evaluate(arr->index);
+                int index = (int)getFloat(indexVal);
+                scope->assignArrayElement(arr->name, index, parsed);
             }
-            scope->assignArray(arrAssign->name, elements);
         }
-        else if (auto arrElemAssign = std::dynamic_pointer_cast<ArrayElementAssignStmt>(cmd)) {
-            int index = (int)getLongDouble(evaluate(arrElemAssign->index));
-            scope->assignArrayElement(arrElemAssign->name, index, evaluate(arrElemAssign->value));
+    }
+    else if (auto bulk = std::dynamic_pointer_cast<ArrayInputStmt>(cmd)) {
+        long long wanted = (long long)getFloat(evaluate(bulk->count));
+        std::vector<Value> values;
+        {
+            MemTag tag(MEM_ARRAYS);
+            values.reserve((size_t)std::max(0LL, std::min(wanted, 1LL << 20)));
         }
-        else if (auto print = std::dynamic_pointer_cast<PrintStmt>(cmd)) {
-            printValue(evaluate(print->expression));
-            if (print->createNewLine) std::cout << "\n";
+        {
+            OutputGuard serialized;
+            std::cout.flush();
         }
-        else if (auto typeStmt = std::dynamic_pointer_cast<TypeStmt>(cmd)) {
-            Value valToCheck = evaluate(typeStmt->expression);
-            if (std::holds_alternative<long long>(valToCheck.data)) std::cout << "<type 'int'>\n";
-            else if (std::holds_alternative<long double>(valToCheck.data)) std::cout << "<type 'float'>\n";
-            else if (std::holds_alternative<std::string>(valToCheck.data)) std::cout << "<type 'string'>\n";
-            else if (std::holds_alternative<bool>(valToCheck.data)) std::cout << "<type 'bool'>\n";
-            else std::cout << "<type 'collection'>\n";
+        std::string_view line;
+        InputBuffer& in = InputBuffer::instance();
+        while ((long long)values.size() < wanted && in.readLine(line)) {
+            values.push_back(parseInput(line));
         }
-        else if (auto exprStmt = std::dynamic_pointer_cast<ExprStmt>(cmd)) {
-            evaluate(exprStmt->expression);
+        scope->assignArrayPrefix(bulk->name, values);
+    }
+    else if (auto assign = std::dynamic_pointer_cast<AssignStmt>(cmd)) {
+        scope->assign(assign->name, evaluate(assign->value));
+    }
+    else if (auto arrDecl = std::dynamic_pointer_cast<ArrayDeclStmt>(cmd)) {
+        scope->declareArray(arrDecl->name);
+    }
+    else if (auto arrAssign = std::dynamic_pointer_cast<ArrayAssignStmt>(cmd)) {
+        std::vector<Value> elements;
+        elements.reserve(arrAssign->value->elements.size());
+        for (const auto& elementExpr : arrAssign->value->elements) {
+            elements.push_back(evaluate(elementExpr));
         }
+        scope->assignArray(arrAssign->name, std::move(elements));
+    }
+    else if (auto arrElemAssign = std::dynamic_pointer_cast<ArrayElementAssignStmt>(cmd)) {
+        Value scratch;
+        int index = (int)getFloat(read(arrElemAssign->index, scratch));
+        scope->assignArrayElement(arrElemAssign->name, index, evaluate(arrElemAssign->value));
+    }
+    else if (auto print = std::dynamic_pointer_cast<PrintStmt>(cmd)) {
+        Value scratch;
+        const Value& shown = read(print->expression, scratch);
+        OutputGuard serialized;
+        printValue(shown);
+        if (print->createNewLine) std::cout.put('\n');
+    }
+    else if (auto typeStmt = std::dynamic_pointer_cast<TypeStmt>(cmd)) {
+        Value scratch;
+        const Value& valToCheck = read(typeStmt->expression, scratch);
+        OutputGuard serialized;
+        if (std::holds_alternative<long long>(valToCheck.data)) std::cout << "<type 'int'>\n";
+        else if (std::holds_alternative<DrimFloat>(valToCheck.data)) std::cout << "<type 'float'>\n";
+        else if (std::holds_alternative<std::string>(valToCheck.data)) std::cout << "<type 'string'>\n";
+        else if (std::holds_alternative<bool>(valToCheck.data)) std::cout << "<type 'bool'>\n";
+        else if (std::holds_alternative<std::shared_ptr<Task>>(valToCheck.data)) std::cout << "<type 'task'>\n";
+        else if (std::holds_alternative<Array>(valToCheck.data)) std::cout << "<type 'array'>\n";
+        else if (std::holds_alternative<std::shared_ptr<Map>>(valToCheck.data)) std::cout << "<type 'map'>\n";
+        else std::cout << "<type 'collection'>\n";
+    }
+    else if (auto exprStmt = std::dynamic_pointer_cast<ExprStmt>(cmd)) {
+        evaluate(exprStmt->expression);
     }
 }
@@ -0,0 +1,692 @@
+#include "../include/Jit.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define DRIM_JIT_AVAILABLE 1
+#include <sys/mman.h>
+#else
+#define DRIM_JIT_AVAILABLE 0
+#endif
+
+enum JitErrorCode { JIT_DIV_ZERO = 1, JIT_MOD_ZERO = 2 };
+
+// Called from generated code; mirrors the interpreter's own messages
+extern "C" [[noreturn]] void drimJitError(int code) {
+    std::cout.flush();
+    if (code == JIT_DIV_ZERO) std::cerr << "Runtime Error: Division by zero\n";
+    else std::cerr << "Runtime Error: Modulo by zero\n";
+    exit(1);
+}
+
+// Expression result kinds inside compiled code. All live in rax as 64 bits;
+// floats as their bit pattern, bools as 0/1, which may only feed conditions
+// and logic operators.
+enum JitKind { JIT_FAIL, JIT_INT, JIT_BOOL, JIT_FLOAT };
+
+// Floats are only compiled when they are doubles (DRIM_DOUBLE_FLOATS);
+// long double needs the x87 unit.
+static constexpr bool NATIVE_FLOATS = std::is_same<DrimFloat, double>::value;
+
+struct Jit::Region {
+    enum State { COLD, COMPILING, READY, NEVER };
+
+    struct Variable {
+        Token name;
+        JitKind kind;
+        int slot;
+    };
+
+    const Stmt* stmt;
+    State state = COLD;
+    int hits = 0;                 // counts up to the threshold, negative while backing off
+    void* code = nullptr;         // entry point; native callers jump through this cell
+    int frame = 0;                // slots the native code uses, locals included
+    std::vector<Variable> variables;   // loops: loaded from and written back to the scope
+    std::vector<JitKind> params;       // functions: the argument kinds compiled for
+    JitKind result = JIT_FAIL;         // functions: the return kind, once a return is compiled
+    std::vector<std::string> names;    // every name given a slot
+    std::vector<std::string> locals;   // names the region creates itself
+    std::vector<std::pair<std::string, Region*>> deps; // callee name -> its region
+
+    // Worked out on the first entry, see Jit::localsFree
+    bool chainChecked = false;
+    bool chainClean = false;
+    std::vector<std::string> guarded;
+
+    Region(const Stmt* s) : stmt(s) {}
+};
+
+// The kind a scope value is compiled as
+static JitKind kindOf(const Value& v) {
+    if (std::holds_alternative<long long>(v.data)) return JIT_INT;
+    if (NATIVE_FLOATS && std::holds_alternative<DrimFloat>(v.data)) return JIT_FLOAT;
+    return JIT_FAIL;
+}
+
+static bool toNative(const Value& v, JitKind kind, int64_t& out) {
+    if (kind == JIT_INT) {
+        auto i = std::get_if<long long>(&v.data);
+        if (!i) return false;
+        out = *i;
+        return true;
+    }
+    auto d = std::get_if<DrimFloat>(&v.data);
+    if (!d) return false;
+    double bits = (double)*d;
+    std::memcpy(&out, &bits, 8);
+    return true;
+}
+
+static Value fromNative(int64_t v, JitKind kind) {
+    if (kind == JIT_INT) return Value((long long)v);
+    double bits;
+    std::memcpy(&bits, &v, 8);
+    return Value((DrimFloat)bits);
+}
+
+// Single-pass code generator. Expressions leave their value in rax, spill
+// the left operand to the native stack, and read variables from the slot
+// array addressed by rbx.
+struct JitCompiler {
+    Jit& jit;
+    Scope& scope;
+    Jit::Region& region;
+    bool isFunction;
+
+    std::vector<uint8_t> code;
+    std::unordered_map<std::string, int> slotIndex;
+    std::vector<JitKind> slotKinds;
+    std::vector<std::vector<std::string>> blocks; // locals each open block created
+
+    struct LoopLabels {
+        size_t head;
+        std::vector<size_t> breaks;
+    };
+    std::vector<LoopLabels> loops;
+    std::vector<size_t> returns;
+
+    JitCompiler(Jit& j, Scope& s, Jit::Region& r, bool func)
+        : jit(j), scope(s), region(r), isFunction(func) {}
+
+    // === Encoding helpers ===
+    void emit(std::initializer_list<uint8_t> bytes) { code.insert(code.end(), bytes); }
+
+    void emit32(int32_t v) {
+        uint8_t b[4];
+        std::memcpy(b, &v, 4);
+        code.insert(code.end(), b, b + 4);
+    }
+
+    void emit64(uint64_t v) {
+        uint8_t b[8];
+        std::memcpy(b, &v, 8);
+        code.insert(code.end(), b, b + 8);
+    }
+
+    // Emits a rel32 jump with the given opcode bytes and returns the patch offset
+    size_t jump(std::initializer_list<uint8_t> opcode) {
+        emit(opcode);
+        size_t at = code.size();
+        emit32(0);
+        return at;
+    }
+
+    void patch(size_t at, size_t target) {
+        int32_t rel = (int32_t)((long long)target - (long long)(at + 4));
+        std::memcpy(&code[at], &rel, 4);
+    }
+
+    void jumpTo(size_t target) { patch(jump({0xE9}), target); }
+
+    void movRaxImm(int64_t v) { emit({0x48, 0xB8}); emit64((uint64_t)v); }
+    void loadSlot(int i) { emit({0x48, 0x8B, 0x83}); emit32(i * 8); }   // mov rax, [rbx+8*i]
+    void storeSlot(int i) { emit({0x48, 0x89, 0x83}); emit32(i * 8); }  // mov [rbx+8*i], rax
+    void pushRax() { emit({0x50}); }
+    void popRcxSwap() { emit({0x48, 0x89, 0xC1, 0x58}); }              // mov rcx, rax; pop rax
+    void testRax() { emit({0x48, 0x85, 0xC0}); }
+    void setcc(uint8_t cc) { emit({0x0F, cc, 0xC0, 0x0F, 0xB6, 0xC0}); } // setcc al; movzx eax, al
+
+    void callError(int errorCode) {
+        emit({0x48, 0x83, 0xE4, 0xF0});              // and rsp, -16
+        emit({0xBF}); emit32(errorCode);             // mov edi, code
+        movRaxImm((int64_t)(intptr_t)&drimJitError);
+        emit({0xFF, 0xD0});                          // call rax
+    }
+
+    void errorIfRcxZero(int errorCode) {
+        emit({0x48, 0x85, 0xC9});                    // test rcx, rcx
+        size_t ok = jump({0x0F, 0x85});              // jnz ok
+        callError(errorCode);
+        patch(ok, code.size());
+    }
+
+    void errorIfXmm1Zero(int errorCode) {
+        emit({0x66, 0x0F, 0x57, 0xD2});              // xorpd xmm2, xmm2
+        emit({0x66, 0x0F, 0x2E, 0xCA});              // ucomisd xmm1, xmm2
+        size_t nan = jump({0x0F, 0x8A});             // jp ok: NaN is not zero
+        size_t ok = jump({0x0F, 0x85});              // jne ok
+        callError(errorCode);
+        patch(nan, code.size());
+        patch(ok, code.size());
+    }
+
+    // rax = (float in rax != 0), NaN included, as isTruthy has it
+    void floatTruth() {
+        emit({0x66, 0x48, 0x0F, 0x6E, 0xC0});        // movq xmm0, rax
+        emit({0x66, 0x0F, 0x57, 0xC9});              // xorpd xmm1, xmm1
+        emit({0x66, 0x0F, 0x2E, 0xC1});              // ucomisd xmm0, xmm1
+        emit({0x0F, 0x95, 0xC0, 0x0F, 0x9A, 0xC1});  // setne al; setp cl
+        emit({0x08, 0xC8, 0x0F, 0xB6, 0xC0});        // or al, cl; movzx eax, al
+    }
+
+    int addSlot(const std::string& name, JitKind kind) {
+        slotIndex[name] = (int)slotKinds.size();
+        slotKinds.push_back(kind);
+        region.names.push_back(name);
+        return (int)slotKinds.size() - 1;
+    }
+
+    // Slot of a variable being read. Loops pick up the scope's variables;
+    // functions only see their params and their own locals.
+    int resolveSlot(const Token& name) {
+        auto it = slotIndex.find(name.lexeme);
+        if (it != slotIndex.end()) return it->second;
+        if (isFunction || !scope.contains(name.lexeme) || scope.hasArray(name.lexeme)) return -1;
+        JitKind kind = kindOf(scope.lookup(name));
+        if (kind == JIT_FAIL) return -1;
+        int slot = addSlot(name.lexeme, kind);
+        region.variables.push_back({name, kind, slot});
+        return slot;
+    }
+
+    // Slot of a variable being assigned a `kind` value. A name nobody holds
+    // becomes a local of the innermost block, as in the interpreter; the
+    // entry guards check it is still free when the code runs.
+    int assignSlot(const Token& name, JitKind kind) {
+        if (kind != JIT_INT && kind != JIT_FLOAT) return -1;
+        int slot = resolveSlot(name);
+        if (slot >= 0) return slotKinds[slot] == kind ? slot : -1;
+        if (!isFunction && scope.contains(name.lexeme)) return -1;
+        region.locals.push_back(name.lexeme);
+        blocks.back().push_back(name.lexeme);
+        return addSlot(name.lexeme, kind);
+    }
+
+    // Leaves a condition in rax, nonzero meaning true
+    bool condition(const std::shared_ptr<Expr>& e) {
+        JitKind k = expr(e);
+        if (k == JIT_FLOAT) floatTruth();
+        return k != JIT_FAIL;
+    }
+
+    // === Expressions ===
+    JitKind expr(const std::shared_ptr<Expr>& e) {
+        if (auto lit = std::dynamic_pointer_cast<LiteralExpr>(e)) {
+            if (auto i = std::get_if<long long>(&lit->value.data)) { movRaxImm(*i); return JIT_INT; }
+            if (auto b = std::get_if<bool>(&lit->value.data)) { movRaxImm(*b ? 1 : 0); return JIT_BOOL; }
+            int64_t bits;
+            if (!NATIVE_FLOATS || !toNative(lit->value, JIT_FLOAT, bits)) return JIT_FAIL;
+            movRaxImm(bits);
+            return JIT_FLOAT;
+        }
+
+        if (auto var = std::dynamic_pointer_cast<VariableExpr>(e)) {
+            int slot = resolveSlot(var->name);
+            if (slot < 0) return JIT_FAIL;
+            loadSlot(slot);
+            return slotKinds[slot];
+        }
+
+        if (auto una = std::dynamic_pointer_cast<UnaryExpr>(e)) {
+            if (una->op.type == TOKEN_BANG) {
+                if (!condition(una->right)) return JIT_FAIL;
+                testRax(); setcc(0x94);
+                return JIT_BOOL;
+            }
+            JitKind k = expr(una->right);
+            if (k == JIT_FLOAT && una->op.type == TOKEN_MINUS) {
+                emit({0x48, 0x0F, 0xBA, 0xF8, 0x3F});    // btc rax, 63
+                return JIT_FLOAT;
+            }
+            if (k != JIT_INT) return JIT_FAIL;
+            if (una->op.type == TOKEN_BIT_NOT) { emit({0x48, 0xF7, 0xD0}); return JIT_INT; }
+            if (una->op.type == TOKEN_MINUS) { emit({0x48, 0xF7, 0xD8}); return JIT_INT; }
+            return JIT_FAIL;
+        }
+
+        // Native code is fast enough to recompute it every time
+        if (auto hoisted = std::dynamic_pointer_cast<HoistedExpr>(e)) return expr(hoisted->original);
+        if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(e)) return binary(*bin);
+        if (auto call = std::dynamic_pointer_cast<CallExpr>(e)) return callExpr(*call);
+        return JIT_FAIL;
+    }
+
+    JitKind binary(const BinaryExpr& bin) {
+        TokenType op = bin.op.type;
+
+        if (op == KW_AND || op == KW_OR) {
+            // The right side only runs if the left one did not decide
+            if (!condition(bin.left)) return JIT_FAIL;
+            testRax(); setcc(0x95); testRax();
+            size_t done = jump(op == KW_AND ? std::initializer_list<uint8_t>{0x0F, 0x84}   // jz: false
+                                            : std::initializer_list<uint8_t>{0x0F, 0x85}); // jnz: true
+            if (!condition(bin.right)) return JIT_FAIL;
+            testRax(); setcc(0x95);
+            patch(done, code.size());
+            return JIT_BOOL;
+        }
+
+        JitKind left = expr(bin.left);
+        if (left != JIT_INT && left != JIT_FLOAT) return JIT_FAIL;
+        pushRax();
+        JitKind right = expr(bin.right);
+        if (right != JIT_INT && right != JIT_FLOAT) return JIT_FAIL;
+        popRcxSwap();
+        if (left == JIT_FLOAT || right == JIT_FLOAT) return floatBinary(op, left, right);
+
+        switch (op) {
+            case TOKEN_PLUS:    emit({0x48, 0x01, 0xC8}); return JIT_INT;
+            case TOKEN_MINUS:   emit({0x48, 0x29, 0xC8}); return JIT_INT;
+            case TOKEN_STAR:    emit({0x48, 0x0F, 0xAF, 0xC1}); return JIT_INT;
+            case TOKEN_BIT_AND: emit({0x48, 0x21, 0xC8}); return JIT_INT;
+            case TOKEN_BIT_OR:  emit({0x48, 0x09, 0xC8}); return JIT_INT;
+            case TOKEN_LSHIFT:  emit({0x48, 0xD3, 0xE0}); return JIT_INT;
+            case TOKEN_RSHIFT:  emit({0x48, 0xD3, 0xF8}); return JIT_INT;
+            case TOKEN_SLASH:
+                errorIfRcxZero(JIT_DIV_ZERO);
+                emit({0x48, 0x99, 0x48, 0xF7, 0xF9});             // cqo; idiv rcx
+                return JIT_INT;
+            case TOKEN_MOD:
+                errorIfRcxZero(JIT_MOD_ZERO);
+                emit({0x48, 0x99, 0x48, 0xF7, 0xF9, 0x48, 0x89, 0xD0}); // cqo; idiv rcx; mov rax, rdx
+                return JIT_INT;
+            case TOKEN_LESS:          emit({0x48, 0x39, 0xC8}); setcc(0x9C); return JIT_BOOL;
+            case TOKEN_GREATER:       emit({0x48, 0x39, 0xC8}); setcc(0x9F); return JIT_BOOL;
+            case TOKEN_LESS_EQUAL:    emit({0x48, 0x39, 0xC8}); setcc(0x9E); return JIT_BOOL;
+            case TOKEN_GREATER_EQUAL: emit({0x48, 0x39, 0xC8}); setcc(0x9D); return JIT_BOOL;
+            case TOKEN_EQUAL_EQUAL:   emit({0x48, 0x39, 0xC8}); setcc(0x94); return JIT_BOOL;
+            case TOKEN_BANG_EQUAL:    emit({0x48, 0x39, 0xC8}); setcc(0x95); return JIT_BOOL;
+            default: return JIT_FAIL; // '^' produces floats
+        }
+    }
+
+    // Left operand in rax, right in rcx. As in the interpreter, an int
+    // meeting a float is converted and the two are compared as floats.
+    JitKind floatBinary(TokenType op, JitKind left, JitKind right) {
+        if (left == JIT_INT) emit({0xF2, 0x48, 0x0F, 0x2A, 0xC0});  // cvtsi2sd xmm0, rax
+        else emit({0x66, 0x48, 0x0F, 0x6E, 0xC0});                  // movq xmm0, rax
+        if (right == JIT_INT) emit({0xF2, 0x48, 0x0F, 0x2A, 0xC9}); // cvtsi2sd xmm1, rcx
+        else emit({0x66, 0x48, 0x0F, 0x6E, 0xC9});                  // movq xmm1, rcx
+
+        // ucomisd sets CF both for "below" and for NaN, so < and <= compare
+        // the other way round and NaN comes out false everywhere but !=
+        switch (op) {
+            case TOKEN_PLUS:  emit({0xF2, 0x0F, 0x58, 0xC1}); break;   // addsd xmm0, xmm1
+            case TOKEN_MINUS: emit({0xF2, 0x0F, 0x5C, 0xC1}); break;   // subsd xmm0, xmm1
+            case TOKEN_STAR:  emit({0xF2, 0x0F, 0x59, 0xC1}); break;   // mulsd xmm0, xmm1
+            case TOKEN_SLASH:
+                errorIfXmm1Zero(JIT_DIV_ZERO);
+                emit({0xF2, 0x0F, 0x5E, 0xC1});                        // divsd xmm0, xmm1
+                break;
+            case TOKEN_LESS:          emit({0x66, 0x0F, 0x2E, 0xC8}); setcc(0x97); return JIT_BOOL; // ucomisd xmm1, xmm0; seta
+            case TOKEN_LESS_EQUAL:    emit({0x66, 0x0F, 0x2E, 0xC8}); setcc(0x93); return JIT_BOOL; // ...; setae
+            case TOKEN_GREATER:       emit({0x66, 0x0F, 0x2E, 0xC1}); setcc(0x97); return JIT_BOOL; // ucomisd xmm0, xmm1; seta
+            case TOKEN_GREATER_EQUAL: emit({0x66, 0x0F, 0x2E, 0xC1}); setcc(0x93); return JIT_BOOL; // ...; setae
+            case TOKEN_EQUAL_EQUAL:
+                emit({0x66, 0x0F, 0x2E, 0xC1});                        // ucomisd xmm0, xmm1
+                emit({0x0F, 0x94, 0xC0, 0x0F, 0x9B, 0xC1});            // sete al; setnp cl
+                emit({0x20, 0xC8, 0x0F, 0xB6, 0xC0});                  // and al, cl; movzx eax, al
+                return JIT_BOOL;
+            case TOKEN_BANG_EQUAL:
+                emit({0x66, 0x0F, 0x2E, 0xC1});                        // ucomisd xmm0, xmm1
+                emit({0x0F, 0x95, 0xC0, 0x0F, 0x9A, 0xC1});            // setne al; setp cl
+                emit({0x08, 0xC8, 0x0F, 0xB6, 0xC0});                  // or al, cl; movzx eax, al
+                return JIT_BOOL;
+            default: return JIT_FAIL; // float '%' and '^' call into libm
+        }
+        emit({0x66, 0x48, 0x0F, 0x7E, 0xC0});                          // movq rax, xmm0
+        return JIT_FLOAT;
+    }
+
+    JitKind callExpr(const CallExpr& call) {
+        auto var = std::dynamic_pointer_cast<VariableExpr>(call.callee);
+        if (!var) return JIT_FAIL;
+        std::shared_ptr<FunctionStmt> callee = scope.getFunc(var->name.lexeme);
+        if (!callee || callee->params.size() != call.arguments.size()) return JIT_FAIL;
+
+        std::vector<JitKind> kinds;
+        for (const auto& arg : call.arguments) {
+            JitKind k = expr(arg);
+            if (k != JIT_INT && k != JIT_FLOAT) return JIT_FAIL;
+            kinds.push_back(k);
+            pushRax();
+        }
+
+        Jit::Region& target = jit.regionFor(callee.get());
+        if (target.state == Jit::Region::NEVER) return JIT_FAIL;
+        if (target.state == Jit::Region::COLD) {
+            target.params = kinds;
+            if (!jit.compileFunction(target, scope)) return JIT_FAIL;
+        }
+        // Compiled for other argument kinds, or recursing before a return told what it gives back
+        if (target.params != kinds || target.result == JIT_FAIL) return JIT_FAIL;
+        region.deps.push_back({var->name.lexeme, &target});
+
+        emit({0x48, 0x89, 0xE7});                    // mov rdi, rsp
+        movRaxImm((int64_t)(intptr_t)&target.code);
+        emit({0xFF, 0x10});                          // call [rax]
+        emit({0x48, 0x81, 0xC4}); emit32((int32_t)(8 * call.arguments.size())); // add rsp, 8*n
+        return target.result;
+    }
+
+    // === Statements ===
+    bool stmts(const std::vector<std::shared_ptr<Stmt>>& list) {
+        for (const auto& s : list) {
+            if (s && !stmt(s)) return false;
+        }
+        return true;
+    }
+
+    bool stmt(const std::shared_ptr<Stmt>& s) {
+        if (auto assign = std::dynamic_pointer_cast<AssignStmt>(s)) {
+            // The value first: it cannot see a local this assignment creates
+            int slot = assignSlot(assign->name, expr(assign->value));
+            if (slot < 0) return false;
+            storeSlot(slot);
+            return true;
+        }
+        if (auto seq = std::dynamic_pointer_cast<SequenceStmt>(s)) return stmts(seq->statements);
+        if (auto block = std::dynamic_pointer_cast<BlockStmt>(s)) {
+            // Locals created in a block end with it
+            blocks.emplace_back();
+            bool ok = stmts(block->statements);
+            for (const auto& name : blocks.back()) slotIndex.erase(name);
+            blocks.pop_back();
+            return ok;
+        }
+
+        if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(s)) {
+            if (!condition(ifStmt->condition)) return false;
+            testRax();
+            size_t toElse = jump({0x0F, 0x84});
+            if (!stmt(ifStmt->thenBranch)) return false;
+            if (!ifStmt->elseBranch) {
+                patch(toElse, code.size());
+                return true;
+            }
+            size_t toEnd = jump({0xE9});
+            patch(toElse, code.size());
+            if (!stmt(ifStmt->elseBranch)) return false;
+            patch(toEnd, code.size());
+            return true;
+        }
+
+        if (auto loop = std::dynamic_pointer_cast<WhileStmt>(s)) return whileLoop(*loop);
+
+        if (std::dynamic_pointer_cast<BreakStmt>(s)) {
+            if (loops.empty()) return false;
+            loops.back().breaks.push_back(jump({0xE9}));
+            return true;
+        }
+        if (std::dynamic_pointer_cast<ContinueStmt>(s)) {
+            if (loops.empty()) return false;
+            jumpTo(loops.back().head);
+            return true;
+        }
+
+        if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(s)) {
+            if (!isFunction) return false;
+            JitKind k = JIT_INT;
+            if (ret->value) {
+                k = expr(ret->value);
+            } else {
+                emit({0x31, 0xC0});                  // xor eax, eax
+            }
+            if (k != JIT_INT && k != JIT_FLOAT) return false;
+            // Every return has to agree with the first one
+            if (region.result == JIT_FAIL) region.result = k;
+            if (k != region.result) return false;
+            returns.push_back(jump({0xE9}));
+            return true;
+        }
+
+        if (auto exprStmt = std::dynamic_pointer_cast<ExprStmt>(s)) {
+            return expr(exprStmt->expression) != JIT_FAIL;
+        }
+        return false;
+    }
+
+    bool whileLoop(const WhileStmt& loop) {
+        loops.push_back({code.size(), {}});
+        if (!condition(loop.condition)) return false;
+        testRax();
+        size_t exit = jump({0x0F, 0x84});
+        if (!stmt(loop.body)) return false;
+        jumpTo(loops.back().head);
+        patch(exit, code.size());
+        for (size_t at : loops.back().breaks) patch(at, code.size());
+        loops.pop_back();
+        return true;
+    }
+
+    // void loop(int64_t* slots)
+    bool compileLoop(const WhileStmt& loop) {
+        emit({0x53, 0x48, 0x89, 0xFB});             // push rbx; mov rbx, rdi
+        blocks.emplace_back();
+        if (!whileLoop(loop)) return false;
+        emit({0x5B, 0xC3});                         // pop rbx; ret
+        region.frame = (int)slotKinds.size();
+        return true;
+    }
+
+    // int64_t func(const int64_t* args), args[n-1-i] holds parameter i.
+    // Parameters take the first slots and locals the ones after them.
+    bool compileFunction(const FunctionStmt& func) {
+        size_t n = func.params.size();
+        for (size_t i = 0; i < n; i++) addSlot(func.params[i].lexeme, region.params[i]);
+
+        emit({0x53, 0x55, 0x48, 0x89, 0xE5});       // push rbx; push rbp; mov rbp, rsp
+        emit({0x48, 0x81, 0xEC});                   // sub rsp, frame (patched below)
+        size_t frameAt = code.size();
+        emit32(0);
+        emit({0x48, 0x89, 0xE3});                   // mov rbx, rsp
+        for (size_t i = 0; i < n; i++) {
+            emit({0x48, 0x8B, 0x87}); emit32((int32_t)(8 * (n - 1 - i))); // mov rax, [rdi+..]
+            storeSlot((int)i);
+        }
+        blocks.emplace_back();
+        if (!stmts(func.body)) return false;
+        if (func.body.empty() || !std::dynamic_pointer_cast<ReturnStmt>(func.body.back())) {
+            // Falling off the end returns 0
+            if (region.result == JIT_FAIL) region.result = JIT_INT;
+            if (region.result != JIT_INT) return false;
+            emit({0x31, 0xC0});                     // xor eax, eax
+        }
+        for (size_t at : returns) patch(at, code.size());
+        emit({0x48, 0x89, 0xEC, 0x5D, 0x5B, 0xC3}); // mov rsp, rbp; pop rbp; pop rbx; ret
+
+        region.frame = (int)slotKinds.size();
+        int32_t frame = (int32_t)(((size_t)region.frame * 8 + 15) & ~(size_t)15);
+        std::memcpy(&code[frameAt], &frame, 4);
+        return true;
+    }
+};
+
+Jit::Jit(int threshold) : threshold(threshold < 1 ? 1 : threshold) {}
+
+Jit::~Jit() {
+#if DRIM_JIT_AVAILABLE
+    for (auto& page : codePages) munmap(page.first, page.second);
+#endif
+}
+
+bool Jit::supported() {
+    return DRIM_JIT_AVAILABLE;
+}
+
+Jit::Region& Jit::regionFor(const Stmt* stmt) {
+    auto& slot = regions[stmt];
+    if (!slot) slot = std::make_unique<Region>(stmt);
+    return *slot;
+}
+
+Jit::Region* Jit::loopEntry(const WhileStmt* loop) {
+    return &regionFor(loop);
+}
+
+void* Jit::install(const std::vector<uint8_t>& code) {
+#if DRIM_JIT_AVAILABLE
+    void* mem = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return nullptr;
+    std::memcpy(mem, code.data(), code.size());
+    if (mprotect(mem, code.size(), PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, code.size());
+        return nullptr;
+    }
+    codePages.push_back({mem, code.size()});
+    return mem;
+#else
+    (void)code;
+    return nullptr;
+#endif
+}
+
+bool Jit::compileLoop(Region& region, Scope& scope) {
+    region.state = Region::COMPILING;
+    region.variables.clear();
+    region.names.clear();
+    region.locals.clear();
+    region.deps.clear();
+    JitCompiler compiler(*this, scope, region, false);
+    bool ok = compiler.compileLoop(*static_cast<const WhileStmt*>(region.stmt));
+    region.code = ok ? install(compiler.code) : nullptr;
+    region.state = region.code ? Region::READY : Region::NEVER;
+    return region.state == Region::READY;
+}
+
+// The caller sets region.params to the argument kinds to compile for
+bool Jit::compileFunction(Region& region, Scope& scope) {
+    region.state = Region::COMPILING;
+    region.result = JIT_FAIL;
+    region.names.clear();
+    region.locals.clear();
+    region.deps.clear();
+    JitCompiler compiler(*this, scope, region, true);
+    bool ok = compiler.compileFunction(*static_cast<const FunctionStmt*>(region.stmt));
+    region.code = ok ? install(compiler.code) : nullptr;
+    region.state = region.code ? Region::READY : Region::NEVER;
+    return region.state == Region::READY;
+}
+
+// Native code calls straight through to its callees, so every function
+// reachable from a region must still be the one the scope resolves and
+// must itself have compiled.
+bool Jit::depsValid(const Region& region, Scope& scope, std::vector<const Region*>& seen) {
+    for (const Region* r : seen) {
+        if (r == &region) return true;
+    }
+    seen.push_back(&region);
+    if (region.state != Region::READY) return false;
+    for (const auto& dep : region.deps) {
+        if (scope.getFunc(dep.first).get() != dep.second->stmt) return false;
+        if (!depsValid(*dep.second, scope, seen)) return false;
+    }
+    return true;
+}
+
+// A drim assignment to a name an enclosing scope already holds writes to
+// that variable, so the locals compiled code keeps in its own slots must be
+// names nobody holds: not the scope it is entered from, and not any caller
+// up the native call chain, whose slots and locals a callee would see.
+bool Jit::localsFree(Region& region, Scope& scope, const std::vector<const Region*>& reachable) {
+    if (!region.chainChecked) {
+        region.chainChecked = true;
+        region.chainClean = true;
+        for (const Region* caller : reachable) {
+            std::vector<const Region*> callees;
+            auto add = [&](const Region* r) {
+                if (std::find(callees.begin(), callees.end(), r) == callees.end()) callees.push_back(r);
+            };
+            for (const auto& dep : caller->deps) add(dep.second);
+            for (size_t i = 0; i < callees.size(); i++) {
+                for (const auto& dep : callees[i]->deps) add(dep.second);
+            }
+            for (const Region* callee : callees) {
+                for (const auto& local : callee->locals) {
+                    if (std::find(caller->names.begin(), caller->names.end(), local) != caller->names.end()) {
+                        region.chainClean = false;
+                    }
+                }
+            }
+            region.guarded.insert(region.guarded.end(), caller->locals.begin(), caller->locals.end());
+        }
+    }
+    if (!region.chainClean) return false;
+    for (const auto& name : region.guarded) {
+        if (scope.contains(name)) return false;
+    }
+    return true;
+}
+
+bool Jit::tryRunLoop(Region* region, Scope& scope) {
+    if (region->state == Region::NEVER) return false;
+    if (region->state != Region::READY) {
+        if (++region->hits < threshold) return false;
+        if (!compileLoop(*region, scope)) return false;
+    }
+    if (region->hits < 0) {
+        region->hits++;
+        return false;
+    }
+
+    std::vector<int64_t> slots(region->frame);
+    for (const auto& var : region->variables) {
+        const std::string& name = var.name.lexeme;
+        if (!scope.contains(name) || scope.hasArray(name) ||
+            !toNative(scope.lookup(var.name), var.kind, slots[var.slot])) {
+            region->hits = -threshold;
+            return false;
+        }
+    }
+    std::vector<const Region*> seen;
+    if (!depsValid(*region, scope, seen) || !localsFree(*region, scope, seen)) {
+        region->hits = -threshold;
+        return false;
+    }
+
+    reinterpret_cast<void (*)(int64_t*)>(region->code)(slots.data());
+
+    for (const auto& var : region->variables) {
+        scope.assign(var.name, fromNative(slots[var.slot], var.kind));
+    }
+    return true;
+}
+
+bool Jit::tryCall(const FunctionStmt* func, Scope& scope, const Value* args, size_t count, Value& result) {
+    Region& region = regionFor(func);
+    if (region.state == Region::NEVER || count > 16) return false;
+    if (region.state != Region::READY) {
+        if (++region.hits < threshold) return false;
+        region.params.clear();
+        for (size_t i = 0; i < count; i++) {
+            JitKind kind = kindOf(args[i]);
+            if (kind == JIT_FAIL) return false;
+            region.params.push_back(kind);
+        }
+        if (!compileFunction(region, scope)) return false;
+    }
+
+    int64_t reversed[16];
+    for (size_t i = 0; i < count; i++) {
+        if (!toNative(args[i], region.params[i], reversed[count - 1 - i])) return false;
+    }
+    std::vector<const Region*> seen;
+    if (!depsValid(region, scope, seen) || !localsFree(region, scope, seen)) return false;
+
+    int64_t value = reinterpret_cast<int64_t (*)(const int64_t*)>(region.code)(reversed);
+    result = fromNative(value, region.result);
+    return true;
+}
@@ -24,6 +24,8 @@ void Lexer::scanToken() {
         case '{': addToken(TOKEN_LBRACE); break;
         case '}': addToken(TOKEN_RBRACE); break;
         case ',': addToken(TOKEN_COMMA); break;
+        case ':': addToken(TOKEN_COLON); break;
+        case '.': addToken(match('.') ? TOKEN_DOT_DOT : TOKEN_ERROR); break;
 
         // Math
         case '+': addToken(TOKEN_PLUS); break;
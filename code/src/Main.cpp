@@ -6,22 +6,187 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
 #include "../include/Lexer.h"
 #include "../include/Parser.h"
 #include "../include/Interpreter.h"
+#include "../include/Output.h"
+#include "../include/ScriptBench.h"
+#include "../include/ThreadPool.h"
+#include "../include/Tasks.h"
+#include "../include/Batch.h"
+#include "../include/Server.h"
+#include "../include/Collector.h"
+#include "../include/MemStats.h"
+#include "../include/Budget.h"
+
+void printUsage() {
+    std::cout << "Usage: drim [options] <script.drim>\n"
+              << "Options:\n"
+              << "  --jit                 Compile hot numeric loops and functions to native code\n"
+              << "  --jit-threshold=N     Iterations/calls before compiling (default 1000)\n"
+              << "  --threads=N           Worker threads for drimming parallel (default: all cores)\n"
+              << "  --line-buffered       Flush wake output after every line\n"
+              << "  --profile[=out.json]  Report per-function and per-line counts and time at exit\n"
+              << "  --sample-profile=HZ   Sample drim stacks HZ times per second of CPU time\n"
+              << "  --sample-out=FILE     Folded stack output (default drim-samples.folded)\n"
+              << "  --trace=out.json      Write a Chrome trace of calls, builtins and phases at exit\n"
+              << "  --batch FILE [-j N]   Run the 'script input output' jobs listed in FILE, N at a time\n"
+              << "  --gc-stats            Print cycle collector runs, reclaimed memory and pauses at exit\n"
+              << "  --gc-threshold=BYTES  Least stack/queue allocation between collector runs (default 4M)\n"
+              << "  --mem-stats[=SECS]    Print live/peak memory by category and the largest arrays and\n"
+              << "                        collections at exit (and a summary every SECS seconds)\n"
+              << "  --max-steps=N         Stop with an error after N loop iterations and calls\n"
+              << "  --max-time=SECS       Stop with an error once the script has run SECS seconds\n"
+              << "  --max-mem=BYTES       Stop with an error once the heap grows past BYTES (K/M/G suffix)\n"
+              << "  --serve SOCKET        Keep running and execute scripts sent by --client over SOCKET\n"
+              << "  --client SOCKET       Run the script on a --serve process instead of in this one\n"
+              << "  --bench N             Run the script N times with output discarded and report phase times\n"
+              << "  --bench-warmup=K      Untimed runs before measuring (default 1)\n"
+              << "  --bench-input=FILE    Input replayed for drim() on every bench run\n";
+}
+
+// "64K", "512M", "2G" or plain bytes
+size_t parseBytes(const std::string& text) {
+    size_t value = std::strtoull(text.c_str(), nullptr, 10);
+    char unit = text.empty() ? '\0' : text.back();
+    if (unit == 'K' || unit == 'k') value <<= 10;
+    if (unit == 'M' || unit == 'm') value <<= 20;
+    if (unit == 'G' || unit == 'g') value <<= 30;
+    return value;
+}
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cout << "Usage: drim <script.drim>\n";
+    const char* scriptPath = nullptr;
+    bool useJit = false;
+    int jitThreshold = 1000;
+    bool lineBuffered = false;
+    bool profile = false;
+    std::string profilePath = "drim-profile.json";
+    int sampleHz = 0;
+    std::string samplePath = "drim-samples.folded";
+    std::string tracePath;
+    int benchRuns = 0;
+    ScriptBenchOptions benchOptions;
+    BatchOptions batchOptions;
+    std::string servePath;
+    std::string clientPath;
+    unsigned long long maxSteps = 0;
+    double maxTime = 0;
+    size_t maxMem = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--jit") {
+            useJit = true;
+        } else if (arg.rfind("--jit-threshold=", 0) == 0) {
+            jitThreshold = std::atoi(arg.c_str() + 16);
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            ThreadPool::instance().setThreads((size_t)std::max(1, std::atoi(arg.c_str() + 10)));
+        } else if (arg == "--line-buffered") {
+            lineBuffered = true;
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg.rfind("--profile=", 0) == 0) {
+            profile = true;
+            profilePath = arg.substr(10);
+        } else if (arg.rfind("--sample-profile=", 0) == 0) {
+            sampleHz = std::atoi(arg.c_str() + 17);
+        } else if (arg.rfind("--sample-out=", 0) == 0) {
+            samplePath = arg.substr(13);
+        } else if (arg.rfind("--trace=", 0) == 0) {
+            tracePath = arg.substr(8);
+        } else if (arg == "--bench" && i + 1 < argc) {
+            benchRuns = std::atoi(argv[++i]);
+        } else if (arg.rfind("--bench=", 0) == 0) {
+            benchRuns = std::atoi(arg.c_str() + 8);
+        } else if (arg.rfind("--bench-warmup=", 0) == 0) {
+            benchOptions.warmup = std::atoi(arg.c_str() + 15);
+        } else if (arg.rfind("--bench-input=", 0) == 0) {
+            benchOptions.inputPath = arg.substr(14);
+        } else if (arg == "--gc-stats") {
+            CycleCollector::reportAtExit();
+        } else if (arg.rfind("--gc-threshold=", 0) == 0) {
+            CycleCollector::setMinTrigger(parseBytes(arg.substr(15)));
+        } else if (arg == "--mem-stats") {
+            MemStats::enable(0);
+        } else if (arg.rfind("--mem-stats=", 0) == 0) {
+            MemStats::enable(std::atoi(arg.c_str() + 12));
+        } else if (arg.rfind("--max-steps=", 0) == 0) {
+            maxSteps = std::strtoull(arg.c_str() + 12, nullptr, 10);
+        } else if (arg.rfind("--max-time=", 0) == 0) {
+            maxTime = std::strtod(arg.c_str() + 11, nullptr);
+        } else if (arg.rfind("--max-mem=", 0) == 0) {
+            maxMem = parseBytes(arg.substr(10));
+        } else if (arg == "--serve" && i + 1 < argc) {
+            servePath = argv[++i];
+        } else if (arg == "--client" && i + 1 < argc) {
+            clientPath = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchOptions.jobsPath = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            batchOptions.jobs = (size_t)std::max(1, std::atoi(argv[++i]));
+        } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2) {
+            batchOptions.jobs = (size_t)std::max(1, std::atoi(arg.c_str() + 2));
+        } else if (arg.rfind("--", 0) == 0 || scriptPath) {
+            printUsage();
+            return 1;
+        } else {
+            scriptPath = argv[i];
+        }
+    }
+
+    if (!servePath.empty()) {
+        if (scriptPath) {
+            printUsage();
+            return 1;
+        }
+        return runServer(servePath);
+    }
+
+    if (!clientPath.empty() && scriptPath) {
+        return runClient(clientPath, scriptPath);
+    }
+
+    if (!batchOptions.jobsPath.empty()) {
+        if (scriptPath) {
+            printUsage();
+            return 1;
+        }
+        OutputBuffer::instance().install(lineBuffered);
+        return runBatch(batchOptions);
+    }
+
+    if (!scriptPath) {
+        printUsage();
         return 1;
     }
 
-    std::ifstream file(argv[1]);
+    if (benchRuns > 0) {
+        OutputBuffer::instance().install(lineBuffered);
+        benchOptions.runs = benchRuns;
+        benchOptions.useJit = useJit && Jit::supported();
+        benchOptions.jitThreshold = jitThreshold;
+        return runScriptBench(scriptPath, benchOptions);
+    }
+
+    std::ifstream file(scriptPath);
     if (!file.is_open()) {
         std::cout << "Error: Could not open file.\n";
         return 1;
     }
 
+    OutputBuffer::instance().install(lineBuffered);
+
+    // Only for a single script: batch, server and bench runs would share one budget
+    if (maxSteps) Budget::limitSteps(maxSteps);
+    if (maxTime > 0) Budget::limitTime(maxTime);
+    if (maxMem) Budget::limitMemory(maxMem);
+
+    Tracer* tracer = tracePath.empty() ? nullptr : &Tracer::start(tracePath);
+
     std::stringstream buffer;
     buffer << file.rdbuf();
     std::string source = buffer.str();
@@ -30,7 +195,11 @@ int main(int argc, char* argv[]) {
 
         Lexer lexer(source);
 
+    {
+        Tracer::Span span(tracer, "lex", "phase");
+        MemTag tag(MEM_TOKENS);
         lexer.scanTokens();
+    }
 
     
 
@@ -38,7 +207,12 @@ int main(int argc, char* argv[]) {
 
         Parser parser(lexer.tokens);
 
-        auto commands = parser.parse();
+    std::vector<std::shared_ptr<Stmt>> commands;
+    {
+        Tracer::Span span(tracer, "parse", "phase");
+        MemTag tag(MEM_AST);
+        commands = parser.parse();
+    }
 
     
 
@@ -46,15 +220,42 @@ int main(int argc, char* argv[]) {
 
         Interpreter interpreter;
 
-    //try catch in case user passes "return" in the main
-    try{
-        interpreter.interpret(commands);
-    }catch(ReturnValue& rv) {
-        return 0;
+    if (profile) interpreter.enableProfiler(&Profiler::start(profilePath, source));
+
+    SampleProfiler* sampler = nullptr;
+    if (sampleHz > 0) {
+        if (SampleProfiler::supported()) sampler = &SampleProfiler::start(sampleHz, samplePath);
+        else std::cerr << "Warning: --sample-profile needs a POSIX timer, ignoring\n";
+        interpreter.enableSampler(sampler);
     }
 
-    
+    if (useJit && Budget::limited()) {
+        std::cerr << "Warning: --jit does not count steps or check limits in compiled code, running interpreted\n";
+    } else if (useJit) {
+        if (Jit::supported()) interpreter.enableJit(jitThreshold);
+        else std::cerr << "Warning: --jit is only available on Linux x86-64, running interpreted\n";
+    }
+
+    {
+        Tracer::Span span(tracer, "execute", "phase");
+
+        //try catch in case user passes "return" in the main
+        try{
+            interpreter.interpret(commands);
+        }catch(ReturnValue& rv) {
+        }
+
+        // Spawned tasks nobody awaited still run to completion
+        TaskScheduler::instance().drain();
+    }
+
+    // Folded stacks name AST functions, so write them before the AST goes away
+    if (sampler) sampler->finish();
+    // Event names point into the AST too
+    if (tracer) tracer->finish();
 
+    // While the script's arrays and collections still exist
+    MemStats::report();
 
     return 0;
 }
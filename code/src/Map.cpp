@@ -0,0 +1,136 @@
+#include "../include/Map.h"
+#include "../include/SymbolTable.h"
+#include <algorithm>
+#include <cmath>
+#include <new>
+
+bool Map::normalizeKey(const Value& key, Value& normalized) {
+    if (std::holds_alternative<long long>(key.data) || std::holds_alternative<std::string>(key.data)) {
+        normalized = key;
+        return true;
+    }
+    if (auto d = std::get_if<DrimFloat>(&key.data)) {
+        // Whole numbers in int range only: 2.5 equals no int, and no string
+        if (std::isfinite(*d) && std::trunc(*d) == *d && *d >= DrimFloat(-9.2233720368547758e18L) &&
+            *d < DrimFloat(9.2233720368547758e18L)) {
+            normalized = Value((long long)*d);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t Map::hashOf(const Value& key) {
+    if (auto i = std::get_if<long long>(&key.data)) {
+        // murmur3's finalizer, so consecutive ints spread over the index
+        uint64_t h = (uint64_t)*i;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+    return (uint64_t)SymbolTable::hashOf(std::get<std::string>(key.data));
+}
+
+size_t Map::probe(const Value& key, uint64_t hash) const {
+    size_t mask = index.size() - 1;
+    uint32_t tag = (uint32_t)(hash >> 32);
+    for (size_t at = hash & mask;; at = (at + 1) & mask) {
+        const Slot& slot = index[at];
+        if (slot.entry == EMPTY) return at;
+        if (slot.entry == DELETED || slot.tag != tag) continue;
+        const Entry& entry = entries[(size_t)slot.entry];
+        if (entry.hash == hash && entry.key == key) return at;
+    }
+}
+
+void Map::rebuild(size_t capacity) {
+    size_t needed = capacity > count ? capacity : count;
+    size_t slots = 8;
+    while (needed > slots / 4 * 3) slots *= 2;
+    // Allocated before the entries move, so a failure leaves the map intact
+    std::vector<Slot> fresh(slots);
+
+    if (entries.size() != count) {
+        size_t kept = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (!entries[i].live) continue;
+            if (kept != i) entries[kept] = std::move(entries[i]);
+            kept++;
+        }
+        entries.resize(kept);
+    }
+
+    index.swap(fresh);
+    size_t mask = slots - 1;
+    for (size_t i = 0; i < entries.size(); i++) {
+        size_t at = entries[i].hash & mask;
+        while (index[at].entry != EMPTY) at = (at + 1) & mask;
+        index[at].entry = (int32_t)i;
+        index[at].tag = (uint32_t)(entries[i].hash >> 32);
+    }
+}
+
+void Map::reserve(size_t expected) {
+    expected = std::min(expected, MAX_KEYS);
+    try {
+        if (expected > index.size() / 4 * 3) rebuild(expected);
+        entries.reserve(expected);
+    } catch (const std::bad_alloc&) {
+    }
+}
+
+const Value* Map::find(const Value& key) const {
+    if (!count) return nullptr;
+    const Slot& slot = index[probe(key, hashOf(key))];
+    return slot.entry == EMPTY ? nullptr : &entries[(size_t)slot.entry].value;
+}
+
+void Map::set(const Value& key, Value value) {
+    uint64_t hash = hashOf(key);
+    if (count) {
+        const Slot& slot = index[probe(key, hash)];
+        if (slot.entry != EMPTY) {
+            entries[(size_t)slot.entry].value = std::move(value);
+            return;
+        }
+    }
+    // Every entry, dead or alive, holds one index slot
+    if ((entries.size() + 1) * 4 > index.size() * 3) rebuild(std::max(count + 1, count * 2));
+    size_t at = probe(key, hash);
+    index[at].entry = (int32_t)entries.size();
+    index[at].tag = (uint32_t)(hash >> 32);
+    entries.push_back({hash, key, std::move(value), true});
+    count++;
+}
+
+bool Map::remove(const Value& key) {
+    if (!count) return false;
+    Slot& slot = index[probe(key, hashOf(key))];
+    if (slot.entry == EMPTY) return false;
+    Entry& entry = entries[(size_t)slot.entry];
+    entry.live = false;
+    entry.key = Value();
+    entry.value = Value();
+    slot.entry = DELETED;
+    if (--count == 0) {
+        entries.clear();
+        index.assign(index.size(), Slot());
+    }
+    return true;
+}
+
+size_t mapSize(const Map& map) {
+    return map.size();
+}
+
+std::vector<Value> Map::keys() const {
+    std::vector<Value> out;
+    out.reserve(count);
+    for (const Entry& entry : entries) {
+        if (entry.live) out.push_back(entry.key);
+    }
+    return out;
+}
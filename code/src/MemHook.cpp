@@ -0,0 +1,78 @@
+// Replaces the global allocation functions so --mem-stats and --max-mem can
+// see every heap block. Linked into the drim executable only: hosts
+// embedding libdrim keep their own operator new.
+
+#include "../include/MemStats.h"
+#include "../include/Budget.h"
+#include <cstdlib>
+#include <new>
+
+#if defined(__linux__)
+#include <malloc.h>
+#define DRIM_BLOCK_SIZE(block) malloc_usable_size(block)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define DRIM_BLOCK_SIZE(block) malloc_size(block)
+#elif defined(_WIN32)
+#include <malloc.h>
+#define DRIM_BLOCK_SIZE(block) _msize(block)
+#else
+#define DRIM_BLOCK_SIZE(block) ((void)(block), (size_t)0) // --max-mem sees nothing
+#endif
+
+namespace {
+
+// --max-mem counts what malloc really handed out, so frees match exactly.
+// A block that would take the heap past the limit is never allocated.
+void checkLimit(std::size_t size) {
+    if (Budget::countingMemory()) Budget::allocating(size);
+}
+
+void countAllocated(void* block) {
+    if (Budget::countingMemory()) Budget::allocated(DRIM_BLOCK_SIZE(block));
+}
+
+void countFreed(void* block) {
+    if (Budget::countingMemory()) Budget::freed(DRIM_BLOCK_SIZE(block));
+}
+
+void* allocate(std::size_t size) {
+    checkLimit(size);
+    void* block = std::malloc(size ? size : 1);
+    if (!block) {
+        if (Budget::countingMemory()) Budget::memoryExceeded(size);
+        throw std::bad_alloc();
+    }
+    countAllocated(block);
+    if (MemStats::enabled()) MemStats::allocated(block, size);
+    return block;
+}
+
+void* allocate(std::size_t size, const std::nothrow_t&) noexcept {
+    checkLimit(size);
+    void* block = std::malloc(size ? size : 1);
+    if (!block) return nullptr;
+    countAllocated(block);
+    if (MemStats::enabled()) MemStats::allocated(block, size);
+    return block;
+}
+
+void release(void* block) noexcept {
+    if (!block) return;
+    countFreed(block);
+    if (MemStats::enabled()) MemStats::freed(block);
+    std::free(block);
+}
+
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t& tag) noexcept { return allocate(size, tag); }
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return allocate(size, tag); }
+void operator delete(void* block) noexcept { release(block); }
+void operator delete[](void* block) noexcept { release(block); }
+void operator delete(void* block, std::size_t) noexcept { release(block); }
+void operator delete[](void* block, std::size_t) noexcept { release(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { release(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { release(block); }
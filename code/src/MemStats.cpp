@@ -0,0 +1,240 @@
+#include "../include/MemStats.h"
+#include "../include/Value.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+std::atomic<bool> MemStats::on{false};
+thread_local MemCategory memstats_detail::current = MEM_OTHER;
+
+namespace {
+
+const char* const CATEGORY_NAMES[MEM_CATEGORIES] = {
+    "other", "ast", "tokens", "scopes", "strings", "arrays", "collections",
+};
+
+// Live blocks by address. Its storage comes from malloc, not new, so the
+// hook never re-enters itself. Linear probing with backward-shift deletion.
+struct Block {
+    void* address;
+    size_t size;
+    MemCategory category;
+};
+
+std::mutex blocksLock;
+Block* blocks = nullptr;
+size_t blockCapacity = 0;
+size_t blockCount = 0;
+size_t live[MEM_CATEGORIES];
+size_t peak[MEM_CATEGORIES];
+unsigned long long allocations[MEM_CATEGORIES];
+
+size_t home(void* address) {
+    return (size_t)(((uintptr_t)address >> 4) * 0x9E3779B97F4A7C15ULL) & (blockCapacity - 1);
+}
+
+void place(const Block& block) {
+    size_t at = home(block.address);
+    while (blocks[at].address) at = (at + 1) & (blockCapacity - 1);
+    blocks[at] = block;
+}
+
+bool growBlocks() {
+    size_t oldCapacity = blockCapacity;
+    Block* old = blocks;
+    size_t bigger = oldCapacity ? oldCapacity * 2 : 1 << 16;
+    Block* fresh = (Block*)std::calloc(bigger, sizeof(Block));
+    if (!fresh) return false;
+    blocks = fresh;
+    blockCapacity = bigger;
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (old[i].address) place(old[i]);
+    }
+    std::free(old);
+    return true;
+}
+
+// Creation sites of live arrays and collections
+std::mutex sitesLock;
+std::unordered_map<const ArrayBuffer*, int>* arraySites = nullptr;
+std::vector<std::pair<std::weak_ptr<std::vector<Value>>, int>>* collectionSites = nullptr;
+size_t collectionsAtLastPrune = 0;
+thread_local int currentLine = 0;
+
+std::atomic<bool> reported{false};
+
+void formatBytes(char* out, size_t size, double bytes) {
+    if (bytes >= 1 << 30) std::snprintf(out, size, "%.1f GiB", bytes / (1 << 30));
+    else if (bytes >= 1 << 20) std::snprintf(out, size, "%.1f MiB", bytes / (1 << 20));
+    else if (bytes >= 1 << 10) std::snprintf(out, size, "%.1f KiB", bytes / (1 << 10));
+    else std::snprintf(out, size, "%.0f B", bytes);
+}
+
+// Heap bytes of a list of values, counting string contents
+size_t listBytes(const std::vector<Value>& items) {
+    size_t bytes = items.capacity() * sizeof(Value);
+    for (const Value& v : items) {
+        if (auto s = std::get_if<std::string>(&v.data)) bytes += s->capacity();
+    }
+    return bytes;
+}
+
+struct Site {
+    size_t bytes;
+    size_t elements;
+    int line;
+};
+
+void printTop(const char* title, std::vector<Site>& sites) {
+    std::sort(sites.begin(), sites.end(), [](const Site& a, const Site& b) { return a.bytes > b.bytes; });
+    std::cerr << title << "\n";
+    if (sites.empty()) std::cerr << "  (none live)\n";
+    char line[160], bytes[32];
+    for (size_t i = 0; i < sites.size() && i < 5; i++) {
+        formatBytes(bytes, sizeof(bytes), (double)sites[i].bytes);
+        std::snprintf(line, sizeof(line), "  %12s  %10zu elements  created on line %d\n",
+                      bytes, sites[i].elements, sites[i].line);
+        std::cerr << line;
+    }
+}
+
+}
+
+void MemStats::allocated(void* block, size_t size) {
+    static thread_local bool busy = false;
+    if (busy || !block) return;
+    busy = true;
+    MemCategory category = memstats_detail::current;
+    {
+        std::lock_guard<std::mutex> guard(blocksLock);
+        if ((blockCount + 1) * 2 <= blockCapacity || growBlocks()) {
+            place({block, size, category});
+            blockCount++;
+            live[category] += size;
+            peak[category] = std::max(peak[category], live[category]);
+            allocations[category]++;
+        }
+    }
+    busy = false;
+}
+
+void MemStats::freed(void* block) {
+    std::lock_guard<std::mutex> guard(blocksLock);
+    if (!blockCount) return;
+    size_t at = home(block);
+    while (blocks[at].address && blocks[at].address != block) at = (at + 1) & (blockCapacity - 1);
+    if (!blocks[at].address) return; // allocated before --mem-stats started counting
+    live[blocks[at].category] -= blocks[at].size;
+    blockCount--;
+    // Shift later entries of the probe run back into the hole
+    size_t hole = at;
+    blocks[hole].address = nullptr;
+    for (size_t next = (hole + 1) & (blockCapacity - 1); blocks[next].address; next = (next + 1) & (blockCapacity - 1)) {
+        size_t want = home(blocks[next].address);
+        bool movable = hole <= next ? (want <= hole || want > next) : (want <= hole && want > next);
+        if (!movable) continue;
+        blocks[hole] = blocks[next];
+        blocks[next].address = nullptr;
+        hole = next;
+    }
+}
+
+void MemStats::setLine(int line) {
+    currentLine = line;
+}
+
+void MemStats::trackArray(const ArrayBuffer* buffer) {
+    MemTag tag(MEM_OTHER);
+    std::lock_guard<std::mutex> guard(sitesLock);
+    if (!arraySites) arraySites = new std::unordered_map<const ArrayBuffer*, int>();
+    (*arraySites)[buffer] = currentLine;
+}
+
+void MemStats::untrackArray(const ArrayBuffer* buffer) {
+    std::lock_guard<std::mutex> guard(sitesLock);
+    if (arraySites) arraySites->erase(buffer);
+}
+
+void MemStats::trackCollection(const std::shared_ptr<std::vector<Value>>& collection) {
+    MemTag tag(MEM_OTHER);
+    std::lock_guard<std::mutex> guard(sitesLock);
+    if (!collectionSites) collectionSites = new std::vector<std::pair<std::weak_ptr<std::vector<Value>>, int>>();
+    // Drop freed collections whenever the list has doubled
+    if (collectionSites->size() >= 2 * collectionsAtLastPrune + 1024) {
+        collectionSites->erase(std::remove_if(collectionSites->begin(), collectionSites->end(),
+                                              [](const auto& site) { return site.first.expired(); }),
+                               collectionSites->end());
+        collectionsAtLastPrune = collectionSites->size();
+    }
+    collectionSites->emplace_back(collection, currentLine);
+}
+
+void MemStats::enable(int intervalSeconds) {
+    if (on.exchange(true)) return;
+    std::atexit(report);
+    if (intervalSeconds <= 0) return;
+    std::thread([intervalSeconds] {
+        char line[512], bytes[32];
+        for (int tick = 1;; tick++) {
+            std::this_thread::sleep_for(std::chrono::seconds(intervalSeconds));
+            if (reported.load()) return;
+            int used = std::snprintf(line, sizeof(line), "drim mem @%ds:", tick * intervalSeconds);
+            std::lock_guard<std::mutex> guard(blocksLock);
+            for (int c = 0; c < MEM_CATEGORIES && used < (int)sizeof(line); c++) {
+                formatBytes(bytes, sizeof(bytes), (double)live[c]);
+                used += std::snprintf(line + used, sizeof(line) - used, " %s %s", CATEGORY_NAMES[c], bytes);
+            }
+            // Straight to stderr: std::cerr would flush the main thread's wake buffer
+            std::fprintf(stderr, "%s\n", line);
+        }
+    }).detach();
+}
+
+void MemStats::report() {
+    if (!enabled() || reported.exchange(true)) return;
+    MemTag tag(MEM_OTHER);
+
+    size_t liveNow[MEM_CATEGORIES], peakNow[MEM_CATEGORIES];
+    unsigned long long countNow[MEM_CATEGORIES];
+    {
+        std::lock_guard<std::mutex> guard(blocksLock);
+        std::copy(live, live + MEM_CATEGORIES, liveNow);
+        std::copy(peak, peak + MEM_CATEGORIES, peakNow);
+        std::copy(allocations, allocations + MEM_CATEGORIES, countNow);
+    }
+
+    char line[160], liveText[32], peakText[32];
+    std::cerr << "drim memory:   category          live          peak   allocations\n";
+    for (int c = 1; c <= MEM_CATEGORIES; c++) {
+        int category = c % MEM_CATEGORIES; // "other" last
+        formatBytes(liveText, sizeof(liveText), (double)liveNow[category]);
+        formatBytes(peakText, sizeof(peakText), (double)peakNow[category]);
+        std::snprintf(line, sizeof(line), "%25s  %12s  %12s  %12llu\n",
+                      CATEGORY_NAMES[category], liveText, peakText, countNow[category]);
+        std::cerr << line;
+    }
+
+    std::vector<Site> arrays, collections;
+    {
+        std::lock_guard<std::mutex> guard(sitesLock);
+        if (arraySites) {
+            for (const auto& site : *arraySites) {
+                arrays.push_back({sizeof(ArrayBuffer) + listBytes(site.first->items), site.first->items.size(), site.second});
+            }
+        }
+        if (collectionSites) {
+            for (const auto& site : *collectionSites) {
+                auto collection = site.first.lock();
+                if (collection) collections.push_back({sizeof(*collection) + listBytes(*collection), collection->size(), site.second});
+            }
+        }
+    }
+    printTop("top arrays:", arrays);
+    printTop("top collections:", collections);
+}
@@ -0,0 +1,609 @@
+#include "../include/Optimizer.h"
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Builtins with no side effects whose result depends only on the arguments
+const std::unordered_set<std::string> PURE_BUILTINS = {
+    "speed", "velocity", "acceleration", "distance", "final_velocity",
+    "force", "weight", "momentum", "impulse", "work", "power",
+    "kinetic_energy", "potential_energy", "pressure", "centripetal_force",
+    "angular_speed", "frequency", "wave_speed", "mass_energy", "heat_energy",
+    "voltage", "current", "electrical_power", "electrical_energy",
+    "to_kelvin", "to_fahrenheit", "array_size",
+};
+
+// Builtins that change a stack or queue at most, never a variable
+const std::unordered_set<std::string> TYPE_STABLE_BUILTINS = {
+    "stack_create", "stack_push", "stack_pop", "stack_peek", "stack_empty", "stack_size",
+    "queue_create", "queue_enqueue", "queue_dequeue", "queue_peek", "queue_empty", "queue_size",
+    "map_create", "map_set", "map_get", "map_has", "map_remove", "map_size", "map_keys", "map_reserve",
+    "await",
+};
+
+using Names = std::set<std::string>;
+
+// In a write set: the loop may change a stack or queue in place, and any
+// name can refer to one, so every variable counts as written
+const std::string ANY_NAME = "";
+
+bool written(const Names& writes, const std::string& name) {
+    return writes.count(name) || writes.count(ANY_NAME);
+}
+
+// Variables named inside {} of an interpolated string
+void interpolatedNames(const std::string& text, std::vector<std::string>& names) {
+    for (size_t open = text.find('{'); open != std::string::npos; open = text.find('{', open + 1)) {
+        size_t close = text.find('}', open);
+        if (close == std::string::npos) break;
+        names.push_back(text.substr(open + 1, close - open - 1));
+    }
+}
+
+// Def-use facts shared by the passes: which names a statement may assign
+struct WriteSets {
+    // Every function the program defines, by name (a name may be defined more than once)
+    std::unordered_map<std::string, std::vector<const FunctionStmt*>> functions;
+    // When false, changing a stack or queue in place is not a write: the
+    // type pass only cares about which value a name holds
+    bool collectionsAlias = true;
+
+    void findFunctions(const std::shared_ptr<Stmt>& s) {
+        if (!s) return;
+        if (auto func = std::dynamic_pointer_cast<FunctionStmt>(s)) {
+            functions[func->name.lexeme].push_back(func.get());
+            for (const auto& inner : func->body) findFunctions(inner);
+        } else if (auto block = std::dynamic_pointer_cast<BlockStmt>(s)) {
+            for (const auto& inner : block->statements) findFunctions(inner);
+        } else if (auto seq = std::dynamic_pointer_cast<SequenceStmt>(s)) {
+            for (const auto& inner : seq->statements) findFunctions(inner);
+        } else if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(s)) {
+            findFunctions(ifStmt->thenBranch);
+            findFunctions(ifStmt->elseBranch);
+        } else if (auto loop = std::dynamic_pointer_cast<WhileStmt>(s)) {
+            findFunctions(loop->body);
+        } else if (auto parallel = std::dynamic_pointer_cast<ParallelForStmt>(s)) {
+            findFunctions(parallel->body);
+        }
+    }
+
+    // === Def-use: the names a loop may assign ===
+
+    void writesOfExpr(const std::shared_ptr<Expr>& e, Names& out, std::set<const FunctionStmt*>& seen) {
+        if (!e) return;
+        if (auto call = std::dynamic_pointer_cast<CallExpr>(e)) {
+            for (const auto& arg : call->arguments) writesOfExpr(arg, out, seen);
+            // Scoping is dynamic, so a callee can assign the caller's variables
+            auto var = std::dynamic_pointer_cast<VariableExpr>(call->callee);
+            auto found = var ? functions.find(var->name.lexeme) : functions.end();
+            if (found == functions.end()) {
+                bool harmless = var && (PURE_BUILTINS.count(var->name.lexeme) ||
+                                        (!collectionsAlias && TYPE_STABLE_BUILTINS.count(var->name.lexeme)));
+                if (!harmless) out.insert(ANY_NAME);
+                return;
+            }
+            for (const FunctionStmt* func : found->second) {
+                if (!seen.insert(func).second) continue;
+                for (const auto& inner : func->body) writesOf(inner, out, seen);
+            }
+        } else if (auto spawn = std::dynamic_pointer_cast<SpawnExpr>(e)) {
+            // Tasks get a fresh scope, but may still change a stack passed to them
+            if (collectionsAlias) out.insert(ANY_NAME);
+            for (const auto& arg : spawn->call->arguments) writesOfExpr(arg, out, seen);
+        } else if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(e)) {
+            writesOfExpr(bin->left, out, seen);
+            writesOfExpr(bin->right, out, seen);
+        } else if (auto una = std::dynamic_pointer_cast<UnaryExpr>(e)) {
+            writesOfExpr(una->right, out, seen);
+        } else if (auto conv = std::dynamic_pointer_cast<ConvertExpr>(e)) {
+            writesOfExpr(conv->value, out, seen);
+            writesOfExpr(conv->mode, out, seen);
+        } else if (auto access = std::dynamic_pointer_cast<ArrayAccessExpr>(e)) {
+            writesOfExpr(access->index, out, seen);
+        } else if (auto slice = std::dynamic_pointer_cast<ArraySliceExpr>(e)) {
+            writesOfExpr(slice->start, out, seen);
+            writesOfExpr(slice->end, out, seen);
+        } else if (auto literal = std::dynamic_pointer_cast<ArrayLiteralExpr>(e)) {
+            for (const auto& element : literal->elements) writesOfExpr(element, out, seen);
+        }
+    }
+
+    void writesOf(const std::shared_ptr<Stmt>& s, Names& out, std::set<const FunctionStmt*>& seen) {
+        if (!s) return;
+        if (auto assign = std::dynamic_pointer_cast<AssignStmt>(s)) {
+            out.insert(assign->name.lexeme);
+            writesOfExpr(assign->value, out, seen);
+        } else if (auto arrAssign = std::dynamic_pointer_cast<ArrayAssignStmt>(s)) {
+            out.insert(arrAssign->name.lexeme);
+            writesOfExpr(arrAssign->value, out, seen);
+        } else if (auto write = std::dynamic_pointer_cast<ArrayElementAssignStmt>(s)) {
+            out.insert(write->name.lexeme);
+            writesOfExpr(write->index, out, seen);
+            writesOfExpr(write->value, out, seen);
+        } else if (auto decl = std::dynamic_pointer_cast<ArrayDeclStmt>(s)) {
+            out.insert(decl->name.lexeme);
+        } else if (auto input = std::dynamic_pointer_cast<InputStmt>(s)) {
+            if (auto var = std::dynamic_pointer_cast<VariableExpr>(input->target)) out.insert(var->name.lexeme);
+            if (auto arr = std::dynamic_pointer_cast<ArrayAccessExpr>(input->target)) out.insert(arr->name.lexeme);
+            writesOfExpr(input->target, out, seen);
+        } else if (auto bulk = std::dynamic_pointer_cast<ArrayInputStmt>(s)) {
+            out.insert(bulk->name.lexeme);
+            writesOfExpr(bulk->count, out, seen);
+        } else if (auto block = std::dynamic_pointer_cast<BlockStmt>(s)) {
+            for (const auto& inner : block->statements) writesOf(inner, out, seen);
+        } else if (auto seq = std::dynamic_pointer_cast<SequenceStmt>(s)) {
+            for (const auto& inner : seq->statements) writesOf(inner, out, seen);
+        } else if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(s)) {
+            writesOfExpr(ifStmt->condition, out, seen);
+            writesOf(ifStmt->thenBranch, out, seen);
+            writesOf(ifStmt->elseBranch, out, seen);
+        } else if (auto loop = std::dynamic_pointer_cast<WhileStmt>(s)) {
+            writesOfExpr(loop->condition, out, seen);
+            writesOf(loop->body, out, seen);
+        } else if (auto parallel = std::dynamic_pointer_cast<ParallelForStmt>(s)) {
+            if (!parallel->indexVar.lexeme.empty()) out.insert(parallel->indexVar.lexeme);
+            if (!parallel->valueVar.lexeme.empty()) out.insert(parallel->valueVar.lexeme);
+            for (const auto& reduction : parallel->reductions) out.insert(reduction.second.lexeme);
+            writesOfExpr(parallel->rangeStart, out, seen);
+            writesOfExpr(parallel->rangeEnd, out, seen);
+            writesOf(parallel->body, out, seen);
+        } else if (auto print = std::dynamic_pointer_cast<PrintStmt>(s)) {
+            writesOfExpr(print->expression, out, seen);
+        } else if (auto typeStmt = std::dynamic_pointer_cast<TypeStmt>(s)) {
+            writesOfExpr(typeStmt->expression, out, seen);
+        } else if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(s)) {
+            writesOfExpr(ret->value, out, seen);
+        } else if (auto exprStmt = std::dynamic_pointer_cast<ExprStmt>(s)) {
+            writesOfExpr(exprStmt->expression, out, seen);
+        }
+    }
+
+};
+
+struct LoopOptimizer : WriteSets {
+    // === Invariance ===
+
+    // True if `e` is pure and reads nothing in `writes`; sets callsBuiltin
+    // if it calls one
+    bool invariant(const std::shared_ptr<Expr>& e, const Names& writes, bool& callsBuiltin) {
+        if (!e) return true;
+        if (auto lit = std::dynamic_pointer_cast<LiteralExpr>(e)) {
+            auto s = std::get_if<std::string>(&lit->value.data);
+            if (!s) return true;
+            std::vector<std::string> names;
+            interpolatedNames(*s, names);
+            for (const auto& name : names) {
+                if (written(writes, name)) return false;
+            }
+            return true;
+        }
+        if (auto var = std::dynamic_pointer_cast<VariableExpr>(e)) return !written(writes, var->name.lexeme);
+        if (std::dynamic_pointer_cast<HoistedExpr>(e)) return true;
+        if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(e)) {
+            bool left = invariant(bin->left, writes, callsBuiltin);
+            return invariant(bin->right, writes, callsBuiltin) && left;
+        }
+        if (auto una = std::dynamic_pointer_cast<UnaryExpr>(e)) return invariant(una->right, writes, callsBuiltin);
+        if (auto conv = std::dynamic_pointer_cast<ConvertExpr>(e)) {
+            bool value = invariant(conv->value, writes, callsBuiltin);
+            return invariant(conv->mode, writes, callsBuiltin) && value;
+        }
+        if (auto access = std::dynamic_pointer_cast<ArrayAccessExpr>(e)) {
+            return !written(writes, access->name.lexeme) && invariant(access->index, writes, callsBuiltin);
+        }
+        if (auto slice = std::dynamic_pointer_cast<ArraySliceExpr>(e)) {
+            return !written(writes, slice->name.lexeme) && invariant(slice->start, writes, callsBuiltin) &&
+                   invariant(slice->end, writes, callsBuiltin);
+        }
+        if (auto literal = std::dynamic_pointer_cast<ArrayLiteralExpr>(e)) {
+            bool all = true;
+            for (const auto& element : literal->elements) all = invariant(element, writes, callsBuiltin) && all;
+            return all;
+        }
+        if (auto call = std::dynamic_pointer_cast<CallExpr>(e)) {
+            auto var = std::dynamic_pointer_cast<VariableExpr>(call->callee);
+            if (!var || functions.count(var->name.lexeme) || !PURE_BUILTINS.count(var->name.lexeme)) return false;
+            callsBuiltin = true;
+            bool all = true;
+            for (const auto& arg : call->arguments) all = invariant(arg, writes, callsBuiltin) && all;
+            return all;
+        }
+        return false; // spawn, and anything new
+    }
+
+    // Worth caching: does some work beyond reading one variable or constant
+    static bool worthHoisting(const std::shared_ptr<Expr>& e) {
+        if (std::dynamic_pointer_cast<VariableExpr>(e) || std::dynamic_pointer_cast<HoistedExpr>(e)) return false;
+        if (auto lit = std::dynamic_pointer_cast<LiteralExpr>(e)) {
+            auto s = std::get_if<std::string>(&lit->value.data);
+            return s && s->find('{') != std::string::npos;
+        }
+        return true;
+    }
+
+    // === Rewriting ===
+
+    void hoistExpr(std::shared_ptr<Expr>& e, WhileStmt& loop, const Names& writes) {
+        if (!e) return;
+        bool callsBuiltin = false;
+        if (invariant(e, writes, callsBuiltin)) {
+            if (worthHoisting(e)) {
+                e = std::make_shared<HoistedExpr>(e, &loop, loop.hoistedCount++, callsBuiltin);
+            }
+            return;
+        }
+        if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(e)) {
+            hoistExpr(bin->left, loop, writes);
+            hoistExpr(bin->right, loop, writes);
+        } else if (auto una = std::dynamic_pointer_cast<UnaryExpr>(e)) {
+            hoistExpr(una->right, loop, writes);
+        } else if (auto conv = std::dynamic_pointer_cast<ConvertExpr>(e)) {
+            hoistExpr(conv->value, loop, writes);
+            hoistExpr(conv->mode, loop, writes);
+        } else if (auto access = std::dynamic_pointer_cast<ArrayAccessExpr>(e)) {
+            hoistExpr(access->index, loop, writes);
+        } else if (auto slice = std::dynamic_pointer_cast<ArraySliceExpr>(e)) {
+            hoistExpr(slice->start, loop, writes);
+            hoistExpr(slice->end, loop, writes);
+        } else if (auto literal = std::dynamic_pointer_cast<ArrayLiteralExpr>(e)) {
+            for (auto& element : literal->elements) hoistExpr(element, loop, writes);
+        } else if (auto call = std::dynamic_pointer_cast<CallExpr>(e)) {
+            for (auto& arg : call->arguments) hoistExpr(arg, loop, writes);
+        } else if (auto spawn = std::dynamic_pointer_cast<SpawnExpr>(e)) {
+            for (auto& arg : spawn->call->arguments) hoistExpr(arg, loop, writes);
+        }
+    }
+
+    // Rewrites the expressions `s` evaluates while `loop` runs. Function
+    // bodies run elsewhere and parallel bodies on other interpreters, so
+    // neither is touched.
+    void hoistStmt(const std::shared_ptr<Stmt>& s, WhileStmt& loop, const Names& writes) {
+        if (!s) return;
+        if (auto assign = std::dynamic_pointer_cast<AssignStmt>(s)) {
+            hoistExpr(assign->value, loop, writes);
+        } else if (auto arrAssign = std::dynamic_pointer_cast<ArrayAssignStmt>(s)) {
+            for (auto& element : arrAssign->value->elements) hoistExpr(element, loop, writes);
+        } else if (auto write = std::dynamic_pointer_cast<ArrayElementAssignStmt>(s)) {
+            hoistExpr(write->index, loop, writes);
+            hoistExpr(write->value, loop, writes);
+        } else if (auto input = std::dynamic_pointer_cast<InputStmt>(s)) {
+            if (auto arr = std::dynamic_pointer_cast<ArrayAccessExpr>(input->target)) {
+                hoistExpr(arr->index, loop, writes);
+            }
+        } else if (auto bulk = std::dynamic_pointer_cast<ArrayInputStmt>(s)) {
+            hoistExpr(bulk->count, loop, writes);
+        } else if (auto block = std::dynamic_pointer_cast<BlockStmt>(s)) {
+            for (const auto& inner : block->statements) hoistStmt(inner, loop, writes);
+        } else if (auto seq = std::dynamic_pointer_cast<SequenceStmt>(s)) {
+            for (const auto& inner : seq->statements) hoistStmt(inner, loop, writes);
+        } else if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(s)) {
+            hoistExpr(ifStmt->condition, loop, writes);
+            hoistStmt(ifStmt->thenBranch, loop, writes);
+            hoistStmt(ifStmt->elseBranch, loop, writes);
+        } else if (auto inner = std::dynamic_pointer_cast<WhileStmt>(s)) {
+            hoistExpr(inner->condition, loop, writes);
+            hoistStmt(inner->body, loop, writes);
+        } else if (auto parallel = std::dynamic_pointer_cast<ParallelForStmt>(s)) {
+            hoistExpr(parallel->rangeStart, loop, writes);
+            hoistExpr(parallel->rangeEnd, loop, writes);
+        } else if (auto print = std::dynamic_pointer_cast<PrintStmt>(s)) {
+            hoistExpr(print->expression, loop, writes);
+        } else if (auto typeStmt = std::dynamic_pointer_cast<TypeStmt>(s)) {
+            hoistExpr(typeStmt->expression, loop, writes);
+        } else if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(s)) {
+            hoistExpr(ret->value, loop, writes);
+        } else if (auto exprStmt = std::dynamic_pointer_cast<ExprStmt>(s)) {
+            hoistExpr(exprStmt->expression, loop, writes);
+        }
+    }
+
+    // Finds every loop, outermost first, so an expression invariant in
+    // several nested loops is cached by the outermost one
+    void visit(const std::shared_ptr<Stmt>& s) {
+        if (!s) return;
+        if (auto loop = std::dynamic_pointer_cast<WhileStmt>(s)) {
+            Names writes;
+            std::set<const FunctionStmt*> seen;
+            writesOf(loop, writes, seen);
+            hoistExpr(loop->condition, *loop, writes);
+            hoistStmt(loop->body, *loop, writes);
+            visit(loop->body);
+        } else if (auto func = std::dynamic_pointer_cast<FunctionStmt>(s)) {
+            for (const auto& inner : func->body) visit(inner);
+        } else if (auto block = std::dynamic_pointer_cast<BlockStmt>(s)) {
+            for (const auto& inner : block->statements) visit(inner);
+        } else if (auto seq = std::dynamic_pointer_cast<SequenceStmt>(s)) {
+            for (const auto& inner : seq->statements) visit(inner);
+        } else if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(s)) {
+            visit(ifStmt->thenBranch);
+            visit(ifStmt->elseBranch);
+        } else if (auto parallel = std::dynamic_pointer_cast<ParallelForStmt>(s)) {
+            visit(parallel->body);
+        }
+    }
+};
+
+// === Type inference ===
+
+enum KnownType { UNKNOWN, INT, FLOAT, ARRAY_INT, ARRAY_FLOAT };
+
+// What each name provably holds at one point of the program. Names that
+// are not in `types` could hold anything. An unreachable state (after
+// return or stopdrim) adds nothing when joined.
+struct TypeState {
+    bool reachable = true;
+    std::map<std::string, KnownType> types;
+
+    static TypeState unreachable() {
+        TypeState state;
+        state.reachable = false;
+        return state;
+    }
+
+    bool operator==(const TypeState& other) const {
+        return reachable == other.reachable && types == other.types;
+    }
+
+    KnownType get(const std::string& name) const {
+        auto found = types.find(name);
+        return found == types.end() ? UNKNOWN : found->second;
+    }
+
+    void set(const std::string& name, KnownType type) {
+        if (type == UNKNOWN) types.erase(name);
+        else types[name] = type;
+    }
+
+    void forget(const Names& names) {
+        if (names.count(ANY_NAME)) {
+            types.clear();
+            return;
+        }
+        for (const auto& name : names) types.erase(name);
+    }
+
+    // Keeps what holds on both paths
+    void join(const TypeState& other) {
+        if (!other.reachable) return;
+        if (!reachable) {
+            *this = other;
+            return;
+        }
+        for (auto it = types.begin(); it != types.end();) {
+            if (other.get(it->first) != it->second) it = types.erase(it);
+            else ++it;
+        }
+    }
+};
+
+bool numeric(KnownType type) { return type == INT || type == FLOAT; }
+
+struct TypeInference : WriteSets {
+    // Joined states at the stopdrim and drimagain statements of each enclosing loop
+    std::vector<std::pair<TypeState, TypeState>> loops;
+    std::set<const FunctionStmt*> analyzed;
+    std::unordered_map<std::string, Names> calleeWrites;
+
+    TypeInference() { collectionsAlias = false; }
+
+    const Names& writesOfCall(const std::string& name) {
+        auto cached = calleeWrites.find(name);
+        if (cached != calleeWrites.end()) return cached->second;
+        Names& out = calleeWrites[name];
+        std::set<const FunctionStmt*> seen;
+        for (const FunctionStmt* func : functions[name]) {
+            if (!seen.insert(func).second) continue;
+            for (const auto& inner : func->body) writesOf(inner, out, seen);
+        }
+        return out;
+    }
+
+    KnownType call(const CallExpr& call, TypeState& state) {
+        for (const auto& arg : call.arguments) expr(arg, state);
+        auto var = std::dynamic_pointer_cast<VariableExpr>(call.callee);
+        if (!var) return UNKNOWN;
+        const std::string& name = var->name.lexeme;
+        if (functions.count(name)) {
+            state.forget(writesOfCall(name));
+            return UNKNOWN;
+        }
+        if (name == "array_size" || name == "stack_size" || name == "queue_size") return INT;
+        if (PURE_BUILTINS.count(name)) return FLOAT; // the physics functions
+        if (!TYPE_STABLE_BUILTINS.count(name)) state.types.clear();
+        return UNKNOWN;
+    }
+
+    KnownType binary(BinaryExpr& bin, TypeState& state) {
+        TokenType op = bin.op.type;
+        KnownType left = expr(bin.left, state);
+        if (op == KW_AND || op == KW_OR) {
+            // The right side may not run
+            TypeState skipped = state;
+            expr(bin.right, state);
+            state.join(skipped);
+            return UNKNOWN;
+        }
+        KnownType right = expr(bin.right, state);
+
+        bin.operands = OPERANDS_UNKNOWN;
+        if (state.reachable && left == right && left == INT) bin.operands = OPERANDS_INT;
+        if (state.reachable && left == right && left == FLOAT) bin.operands = OPERANDS_FLOAT;
+
+        if (!numeric(left) || !numeric(right)) return UNKNOWN;
+        bool ints = left == INT && right == INT;
+        switch (op) {
+            case TOKEN_PLUS: case TOKEN_MINUS: case TOKEN_STAR: case TOKEN_SLASH: case TOKEN_MOD:
+                return ints ? INT : FLOAT;
+            case TOKEN_POW:
+                return FLOAT;
+            case TOKEN_BIT_AND: case TOKEN_BIT_OR: case TOKEN_LSHIFT: case TOKEN_RSHIFT:
+                return ints ? INT : UNKNOWN;
+            default:
+                return UNKNOWN; // comparisons give bools
+        }
+    }
+
+    // Types `e`, applying the effects of the calls in it to `state` in evaluation order
+    KnownType expr(const std::shared_ptr<Expr>& e, TypeState& state) {
+        if (!e) return UNKNOWN;
+        if (auto lit = std::dynamic_pointer_cast<LiteralExpr>(e)) {
+            if (std::holds_alternative<long long>(lit->value.data)) return INT;
+            if (std::holds_alternative<DrimFloat>(lit->value.data)) return FLOAT;
+            return UNKNOWN;
+        }
+        if (auto var = std::dynamic_pointer_cast<VariableExpr>(e)) return state.get(var->name.lexeme);
+        if (auto hoisted = std::dynamic_pointer_cast<HoistedExpr>(e)) return expr(hoisted->original, state);
+        if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(e)) return binary(*bin, state);
+        if (auto una = std::dynamic_pointer_cast<UnaryExpr>(e)) {
+            KnownType right = expr(una->right, state);
+            if (una->op.type == TOKEN_BIT_NOT) return right == INT ? INT : UNKNOWN;
+            if (una->op.type == TOKEN_MINUS) return numeric(right) ? right : UNKNOWN;
+            return UNKNOWN;
+        }
+        if (auto conv = std::dynamic_pointer_cast<ConvertExpr>(e)) {
+            expr(conv->value, state);
+            expr(conv->mode, state);
+            return FLOAT;
+        }
+        if (auto access = std::dynamic_pointer_cast<ArrayAccessExpr>(e)) {
+            expr(access->index, state);
+            KnownType array = state.get(access->name.lexeme);
+            return array == ARRAY_INT ? INT : array == ARRAY_FLOAT ? FLOAT : UNKNOWN;
+        }
+        if (auto slice = std::dynamic_pointer_cast<ArraySliceExpr>(e)) {
+            expr(slice->start, state);
+            expr(slice->end, state);
+            return state.get(slice->name.lexeme);
+        }
+        if (auto literal = std::dynamic_pointer_cast<ArrayLiteralExpr>(e)) {
+            KnownType element = UNKNOWN;
+            for (size_t i = 0; i < literal->elements.size(); i++) {
+                KnownType type = expr(literal->elements[i], state);
+                element = (i == 0 || type == element) ? type : UNKNOWN;
+            }
+            return element == INT ? ARRAY_INT : element == FLOAT ? ARRAY_FLOAT : UNKNOWN;
+        }
+        if (auto c = std::dynamic_pointer_cast<CallExpr>(e)) return call(*c, state);
+        if (auto spawn = std::dynamic_pointer_cast<SpawnExpr>(e)) {
+            for (const auto& arg : spawn->call->arguments) expr(arg, state);
+            return UNKNOWN;
+        }
+        return UNKNOWN;
+    }
+
+    void loop(WhileStmt& loop, TypeState& state) {
+        // Iterate until the state at the top of the loop stops shrinking;
+        // the last pass over the body then saw the final state
+        TypeState head = state;
+        while (true) {
+            TypeState current = head;
+            expr(loop.condition, current);
+            TypeState exit = current;
+            loops.emplace_back(TypeState::unreachable(), TypeState::unreachable());
+            stmt(loop.body, current);
+            current.join(loops.back().second);
+            exit.join(loops.back().first);
+            loops.pop_back();
+
+            TypeState next = head;
+            next.join(current);
+            if (next == head) {
+                state = exit;
+                return;
+            }
+            head = next;
+        }
+    }
+
+    void stmt(const std::shared_ptr<Stmt>& s, TypeState& state) {
+        if (!s) return;
+        if (auto assign = std::dynamic_pointer_cast<AssignStmt>(s)) {
+            state.set(assign->name.lexeme, expr(assign->value, state));
+        } else if (auto arrAssign = std::dynamic_pointer_cast<ArrayAssignStmt>(s)) {
+            state.set(arrAssign->name.lexeme, expr(arrAssign->value, state));
+        } else if (auto write = std::dynamic_pointer_cast<ArrayElementAssignStmt>(s)) {
+            expr(write->index, state);
+            KnownType value = expr(write->value, state);
+            // Writing past the end pads with int 0, so only int arrays stay proven
+            if (!(value == INT && state.get(write->name.lexeme) == ARRAY_INT)) state.set(write->name.lexeme, UNKNOWN);
+        } else if (auto decl = std::dynamic_pointer_cast<ArrayDeclStmt>(s)) {
+            state.set(decl->name.lexeme, UNKNOWN);
+        } else if (auto input = std::dynamic_pointer_cast<InputStmt>(s)) {
+            if (auto var = std::dynamic_pointer_cast<VariableExpr>(input->target)) state.set(var->name.lexeme, UNKNOWN);
+            if (auto arr = std::dynamic_pointer_cast<ArrayAccessExpr>(input->target)) {
+                expr(arr->index, state);
+                state.set(arr->name.lexeme, UNKNOWN);
+            }
+        } else if (auto bulk = std::dynamic_pointer_cast<ArrayInputStmt>(s)) {
+            expr(bulk->count, state);
+            state.set(bulk->name.lexeme, UNKNOWN);
+        } else if (auto print = std::dynamic_pointer_cast<PrintStmt>(s)) {
+            expr(print->expression, state);
+        } else if (auto typeStmt = std::dynamic_pointer_cast<TypeStmt>(s)) {
+            expr(typeStmt->expression, state);
+        } else if (auto exprStmt = std::dynamic_pointer_cast<ExprStmt>(s)) {
+            expr(exprStmt->expression, state);
+        } else if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(s)) {
+            expr(ret->value, state);
+            state = TypeState::unreachable();
+        } else if (std::dynamic_pointer_cast<BreakStmt>(s)) {
+            if (!loops.empty()) loops.back().first.join(state);
+            state = TypeState::unreachable();
+        } else if (std::dynamic_pointer_cast<ContinueStmt>(s)) {
+            if (!loops.empty()) loops.back().second.join(state);
+            state = TypeState::unreachable();
+        } else if (auto block = std::dynamic_pointer_cast<BlockStmt>(s)) {
+            // A name the block creates is gone afterwards, so claims about it are moot
+            for (const auto& inner : block->statements) stmt(inner, state);
+        } else if (auto seq = std::dynamic_pointer_cast<SequenceStmt>(s)) {
+            for (const auto& inner : seq->statements) stmt(inner, state);
+        } else if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(s)) {
+            expr(ifStmt->condition, state);
+            TypeState otherwise = state;
+            stmt(ifStmt->thenBranch, state);
+            stmt(ifStmt->elseBranch, otherwise);
+            state.join(otherwise);
+        } else if (auto whileStmt = std::dynamic_pointer_cast<WhileStmt>(s)) {
+            loop(*whileStmt, state);
+        } else if (auto parallel = std::dynamic_pointer_cast<ParallelForStmt>(s)) {
+            expr(parallel->rangeStart, state);
+            expr(parallel->rangeEnd, state);
+            // Every iteration starts from the outer values of the names the body leaves alone
+            Names writes;
+            std::set<const FunctionStmt*> seen;
+            writesOf(parallel, writes, seen);
+            state.forget(writes);
+            TypeState body = state;
+            loops.emplace_back(TypeState::unreachable(), TypeState::unreachable());
+            stmt(parallel->body, body);
+            loops.pop_back();
+        } else if (auto func = std::dynamic_pointer_cast<FunctionStmt>(s)) {
+            // Parameters and the caller's variables could be anything
+            if (!analyzed.insert(func.get()).second) return;
+            std::vector<std::pair<TypeState, TypeState>> outer;
+            outer.swap(loops);
+            TypeState entry;
+            for (const auto& inner : func->body) stmt(inner, entry);
+            loops.swap(outer);
+        }
+    }
+};
+
+}
+
+void hoistLoopInvariants(std::vector<std::shared_ptr<Stmt>>& program) {
+    LoopOptimizer optimizer;
+    for (const auto& s : program) optimizer.findFunctions(s);
+    for (const auto& s : program) optimizer.visit(s);
+}
+
+void inferTypes(std::vector<std::shared_ptr<Stmt>>& program) {
+    TypeInference inference;
+    for (const auto& s : program) inference.findFunctions(s);
+    TypeState state;
+    for (const auto& s : program) inference.stmt(s, state);
+}
@@ -0,0 +1,176 @@
+#include "../include/Output.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <atomic>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#include <cerrno>
+#define DRIM_POSIX_IO 1
+#else
+#define DRIM_POSIX_IO 0
+#endif
+
+static thread_local std::string* capturedOut = nullptr;
+static thread_local std::string* capturedErr = nullptr;
+static thread_local const OutputBuffer::Drain* capturedDrain = nullptr;
+
+// Sits in std::cout / std::cerr once any thread captures, forwarding to the
+// stream's previous buffer for threads that do not
+class ThreadCapture : public std::streambuf {
+public:
+    ThreadCapture(std::streambuf* original, std::string* (*sink)(), bool isError)
+        : original(original), sink(sink), isError(isError) {}
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+        char c = traits_type::to_char_type(ch);
+        return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        if (std::string* captured = sink()) {
+            captured->append(s, (size_t)n);
+            if (capturedDrain) (*capturedDrain)(*captured, isError, false);
+            return n;
+        }
+        return original->sputn(s, n);
+    }
+    int sync() override {
+        std::string* captured = sink();
+        if (!captured) return original->pubsync();
+        if (capturedDrain) (*capturedDrain)(*captured, isError, true);
+        return 0;
+    }
+
+private:
+    std::streambuf* original;
+    std::string* (*sink)();
+    bool isError;
+};
+
+OutputBuffer& OutputBuffer::instance() {
+    // Never destroyed: std::cout is flushed during static destruction and
+    // must still find its buffer alive.
+    static OutputBuffer* buf = new OutputBuffer();
+    return *buf;
+}
+
+void OutputBuffer::install(bool forceLineBuffered) {
+#if DRIM_POSIX_IO
+    lineBuffered = forceLineBuffered || isatty(STDOUT_FILENO);
+#else
+    lineBuffered = forceLineBuffered;
+#endif
+    std::cout.flush();
+    std::cout.rdbuf(this);
+    std::atexit([] { instance().flush(); });
+}
+
+void OutputBuffer::writeOut(const char* data, size_t size) {
+#if DRIM_POSIX_IO
+    while (size > 0) {
+        ssize_t n = ::write(STDOUT_FILENO, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return; // stdout is gone (closed pipe etc.), drop the output
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+#else
+    std::fwrite(data, 1, size, stdout);
+    std::fflush(stdout);
+#endif
+}
+
+void OutputBuffer::flush() {
+    if (used == 0) return;
+    writeOut(buffer, used);
+    used = 0;
+}
+
+void OutputBuffer::setDiscard(bool on) {
+    flush();
+    discard = on;
+}
+
+void OutputBuffer::captureThread(std::string* out, std::string* err) {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        // Never destroyed, like the output buffer
+        std::cout.rdbuf(new ThreadCapture(std::cout.rdbuf(), [] { return capturedOut; }, false));
+        std::cerr.rdbuf(new ThreadCapture(std::cerr.rdbuf(), [] { return capturedErr; }, true));
+    });
+    capturedOut = out;
+    capturedErr = err;
+}
+
+void OutputBuffer::capturedThread(std::string*& out, std::string*& err) {
+    out = capturedOut;
+    err = capturedErr;
+}
+
+void OutputBuffer::drainThread(const Drain* drain) {
+    capturedDrain = drain;
+}
+
+const OutputBuffer::Drain* OutputBuffer::drainedThread() {
+    return capturedDrain;
+}
+
+void OutputBuffer::write(const char* data, size_t size) {
+    if (discard) return;
+    if (size >= CAPACITY) {
+        // Too big to batch, send it straight through
+        flush();
+        writeOut(data, size);
+    } else {
+        if (used + size > CAPACITY) flush();
+        std::memcpy(buffer + used, data, size);
+        used += size;
+    }
+    if (lineBuffered && std::memchr(data, '\n', size)) flush();
+}
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+    char c = traits_type::to_char_type(ch);
+    write(&c, 1);
+    return ch;
+}
+
+std::streamsize OutputBuffer::xsputn(const char* s, std::streamsize n) {
+    write(s, (size_t)n);
+    return n;
+}
+
+int OutputBuffer::sync() {
+    flush();
+    return 0;
+}
+
+static std::atomic<int> concurrentSections{0};
+
+static std::mutex& outputLock() {
+    static std::mutex lock;
+    return lock;
+}
+
+void OutputBuffer::enterConcurrent() {
+    concurrentSections.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void OutputBuffer::leaveConcurrent() {
+    concurrentSections.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+bool OutputBuffer::concurrent() {
+    return concurrentSections.load(std::memory_order_acquire) > 0;
+}
+
+OutputGuard::OutputGuard() {
+    if (concurrentSections.load(std::memory_order_acquire) > 0) lock = std::unique_lock<std::mutex>(outputLock());
+}
@@ -0,0 +1,350 @@
+#include "../include/Parallel.h"
+#include "../include/Interpreter.h"
+#include "../include/ThreadPool.h"
+#include "../include/DS.h"
+#include "../include/Output.h"
+#include "../include/Signal.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+
+std::string valToString(const Value& v); // Interpreter.cpp
+
+// Loops are cut into at most this many chunks. The count does not depend on
+// the number of threads, so reductions combine the same partials in the
+// same order (and give the same float result) however many threads run.
+static const size_t MAX_CHUNKS = 1024;
+
+struct ParallelRegion {
+    size_t iterations = 0;
+    size_t chunkSize = 1;
+    size_t chunkCount = 0;
+    // Per worker: the chunks it still owns, packed as (front << 32) | back.
+    // The owner pops from the front, thieves take from the back.
+    std::unique_ptr<std::atomic<unsigned long long>[]> ranges;
+    size_t workers = 0;
+
+    // Per shared array: iteration + 1 of the writer of each element, 0 if none
+    std::mutex claimLock;
+    std::map<const std::vector<Value>*, std::unique_ptr<std::atomic<unsigned long long>[]>> claims;
+
+    // Reduction partial of every chunk, chunk-major
+    std::vector<Value> partials;
+
+    long long takeChunk(size_t id);
+};
+
+static bool popFront(std::atomic<unsigned long long>& range, long long& chunk) {
+    unsigned long long packed = range.load(std::memory_order_relaxed);
+    while (true) {
+        unsigned long long front = packed >> 32, back = packed & 0xffffffffULL;
+        if (front >= back) return false;
+        if (range.compare_exchange_weak(packed, ((front + 1) << 32) | back, std::memory_order_acq_rel)) {
+            chunk = (long long)front;
+            return true;
+        }
+    }
+}
+
+static bool popBack(std::atomic<unsigned long long>& range, long long& chunk) {
+    unsigned long long packed = range.load(std::memory_order_relaxed);
+    while (true) {
+        unsigned long long front = packed >> 32, back = packed & 0xffffffffULL;
+        if (front >= back) return false;
+        if (range.compare_exchange_weak(packed, (front << 32) | (back - 1), std::memory_order_acq_rel)) {
+            chunk = (long long)(back - 1);
+            return true;
+        }
+    }
+}
+
+long long ParallelRegion::takeChunk(size_t id) {
+    long long chunk;
+    if (popFront(ranges[id], chunk)) return chunk;
+    for (size_t k = 1; k < workers; k++) {
+        if (popBack(ranges[(id + k) % workers], chunk)) return chunk;
+    }
+    return -1;
+}
+
+void claimParallelWrite(ParallelWorker* worker, unsigned long long iteration,
+                        const std::string& name, std::vector<Value>& arr, int index) {
+    if (worker->lastArray != &arr) {
+        ParallelRegion& region = *worker->region;
+        std::lock_guard<std::mutex> guard(region.claimLock);
+        auto& table = region.claims[&arr];
+        if (!table) table.reset(new std::atomic<unsigned long long>[arr.size()]());
+        worker->lastArray = &arr;
+        worker->lastClaims = table.get();
+    }
+
+    unsigned long long mine = iteration + 1;
+    unsigned long long owner = 0;
+    std::atomic<unsigned long long>& slot = worker->lastClaims[index];
+    if (slot.compare_exchange_strong(owner, mine, std::memory_order_relaxed) || owner == mine) return;
+
+    std::cerr << "Runtime Error: Iterations " << owner - 1 << " and " << iteration
+              << " of drimming parallel both write " << name << "[" << index << "]\n";
+    drimExit(1);
+}
+
+Value parallelDS(ParallelWorker& worker, const std::string& name, const Value* args, size_t count) {
+    if (name == "stack_create" || name == "queue_create") {
+        Value created = execDS(name, args, count);
+        worker.ownCollections.insert(std::get<std::shared_ptr<std::vector<Value>>>(created.data).get());
+        return created;
+    }
+    if (name == "map_create") {
+        Value created = execDS(name, args, count);
+        worker.ownCollections.insert(std::get<std::shared_ptr<Map>>(created.data).get());
+        return created;
+    }
+
+    bool mutates = name == "stack_push" || name == "stack_pop" || name == "queue_enqueue" || name == "queue_dequeue" ||
+                   name == "map_set" || name == "map_remove" || name == "map_reserve";
+    if (mutates && count >= 1) {
+        const void* target = nullptr;
+        if (auto list = std::get_if<std::shared_ptr<std::vector<Value>>>(&args[0].data)) target = list->get();
+        if (auto map = std::get_if<std::shared_ptr<Map>>(&args[0].data)) target = map->get();
+        if (target && !worker.ownCollections.count(target)) {
+            std::cerr << "Runtime Error: '" << name << "' cannot change a shared collection inside drimming parallel\n";
+            drimExit(1);
+        }
+    }
+    return execDS(name, args, count);
+}
+
+static Value reductionIdentity(TokenType op) {
+    if (op == TOKEN_STAR) return Value(1LL);
+    if (op == TOKEN_BIT_AND) return Value(-1LL);
+    return Value(0LL);
+}
+
+// Same results as writing `total = total <op> partial` in drim
+static Value combine(TokenType op, const Value& a, const Value& b, const Token& var) {
+    auto ai = std::get_if<long long>(&a.data);
+    auto bi = std::get_if<long long>(&b.data);
+    if (ai && bi) {
+        if (op == TOKEN_PLUS) return Value(*ai + *bi);
+        if (op == TOKEN_STAR) return Value(*ai * *bi);
+        if (op == TOKEN_BIT_AND) return Value(*ai & *bi);
+        return Value(*ai | *bi);
+    }
+
+    bool aNum = ai || std::holds_alternative<DrimFloat>(a.data);
+    bool bNum = bi || std::holds_alternative<DrimFloat>(b.data);
+    if (aNum && bNum && (op == TOKEN_PLUS || op == TOKEN_STAR)) {
+        DrimFloat l = ai ? (DrimFloat)*ai : std::get<DrimFloat>(a.data);
+        DrimFloat r = bi ? (DrimFloat)*bi : std::get<DrimFloat>(b.data);
+        return Value(op == TOKEN_PLUS ? l + r : l * r);
+    }
+    if (op == TOKEN_PLUS && !std::holds_alternative<bool>(a.data) && !std::holds_alternative<bool>(b.data)) {
+        return Value(valToString(a) + valToString(b));
+    }
+
+    std::cerr << "Runtime Error: Cannot reduce '" << var.lexeme << "' with these value types on line "
+              << var.line << "\n";
+    drimExit(1);
+}
+
+// Names of the arrays a loop body may write elements of, following the
+// functions it calls. They get buffers of their own before the workers
+// start, so no worker ever has to copy-on-write a shared array.
+struct ArrayWrites {
+    Scope& scope;
+    std::set<std::string> names;
+    std::set<const FunctionStmt*> seen;
+
+    explicit ArrayWrites(Scope& s) : scope(s) {}
+
+    void expr(const std::shared_ptr<Expr>& e) {
+        if (!e) return;
+        if (auto call = std::dynamic_pointer_cast<CallExpr>(e)) {
+            for (const auto& arg : call->arguments) expr(arg);
+            auto var = std::dynamic_pointer_cast<VariableExpr>(call->callee);
+            auto func = var ? scope.getFunc(var->name.lexeme) : nullptr;
+            if (func && seen.insert(func.get()).second) {
+                for (const auto& inner : func->body) stmt(inner);
+            }
+        } else if (auto spawn = std::dynamic_pointer_cast<SpawnExpr>(e)) {
+            for (const auto& arg : spawn->call->arguments) expr(arg);
+        } else if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(e)) {
+            expr(bin->left);
+            expr(bin->right);
+        } else if (auto una = std::dynamic_pointer_cast<UnaryExpr>(e)) {
+            expr(una->right);
+        } else if (auto hoisted = std::dynamic_pointer_cast<HoistedExpr>(e)) {
+            expr(hoisted->original);
+        } else if (auto conv = std::dynamic_pointer_cast<ConvertExpr>(e)) {
+            expr(conv->value);
+            expr(conv->mode);
+        } else if (auto access = std::dynamic_pointer_cast<ArrayAccessExpr>(e)) {
+            expr(access->index);
+        } else if (auto slice = std::dynamic_pointer_cast<ArraySliceExpr>(e)) {
+            expr(slice->start);
+            expr(slice->end);
+        } else if (auto literal = std::dynamic_pointer_cast<ArrayLiteralExpr>(e)) {
+            for (const auto& element : literal->elements) expr(element);
+        }
+    }
+
+    void stmt(const std::shared_ptr<Stmt>& s) {
+        if (!s) return;
+        if (auto write = std::dynamic_pointer_cast<ArrayElementAssignStmt>(s)) {
+            names.insert(write->name.lexeme);
+            expr(write->index);
+            expr(write->value);
+        } else if (auto block = std::dynamic_pointer_cast<BlockStmt>(s)) {
+            for (const auto& inner : block->statements) stmt(inner);
+        } else if (auto seq = std::dynamic_pointer_cast<SequenceStmt>(s)) {
+            for (const auto& inner : seq->statements) stmt(inner);
+        } else if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(s)) {
+            expr(ifStmt->condition);
+            stmt(ifStmt->thenBranch);
+            stmt(ifStmt->elseBranch);
+        } else if (auto loop = std::dynamic_pointer_cast<WhileStmt>(s)) {
+            expr(loop->condition);
+            stmt(loop->body);
+        } else if (auto inner = std::dynamic_pointer_cast<ParallelForStmt>(s)) {
+            expr(inner->rangeStart);
+            expr(inner->rangeEnd);
+            stmt(inner->body);
+        } else if (auto assign = std::dynamic_pointer_cast<AssignStmt>(s)) {
+            expr(assign->value);
+        } else if (auto arrAssign = std::dynamic_pointer_cast<ArrayAssignStmt>(s)) {
+            expr(arrAssign->value);
+        } else if (auto print = std::dynamic_pointer_cast<PrintStmt>(s)) {
+            expr(print->expression);
+        } else if (auto typeStmt = std::dynamic_pointer_cast<TypeStmt>(s)) {
+            expr(typeStmt->expression);
+        } else if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(s)) {
+            expr(ret->value);
+        } else if (auto exprStmt = std::dynamic_pointer_cast<ExprStmt>(s)) {
+            expr(exprStmt->expression);
+        }
+    }
+};
+
+Interpreter::Interpreter(std::shared_ptr<Scope> workerScope, ParallelWorker* w)
+    : scope(std::move(workerScope)), tracer(Tracer::active()), worker(w) {
+    argStack.reserve(64);
+}
+
+void Interpreter::executeParallel(const ParallelForStmt& loop) {
+    long long first = 0;
+    const Array* items = nullptr;
+    size_t iterations = 0;
+
+    if (loop.rangeEnd) {
+        Value startVal = evaluate(loop.rangeStart);
+        Value endVal = evaluate(loop.rangeEnd);
+        auto start = std::get_if<long long>(&startVal.data);
+        auto end = std::get_if<long long>(&endVal.data);
+        if (!start || !end) {
+            std::cerr << "Runtime Error: drimming parallel range bounds must be ints on line " << loop.line << "\n";
+            drimExit(1);
+        }
+        first = *start;
+        if (*end > *start) iterations = (size_t)(*end - *start);
+    } else {
+        items = &scope->getArray(loop.arrayName);
+        iterations = items->size();
+    }
+
+    const size_t reductionCount = loop.reductions.size();
+    for (const auto& reduction : loop.reductions) {
+        scope->get(reduction.second); // must exist before the loop
+    }
+    if (iterations == 0) return;
+
+    if (!worker) {
+        ArrayWrites writes(*scope);
+        writes.stmt(loop.body);
+        for (const auto& name : writes.names) scope->unshareArray(name);
+    }
+
+    ParallelRegion region;
+    region.iterations = iterations;
+    region.chunkSize = (iterations + MAX_CHUNKS - 1) / MAX_CHUNKS;
+    region.chunkCount = (iterations + region.chunkSize - 1) / region.chunkSize;
+    // A loop nested inside a worker runs on that worker alone, and so does
+    // one in a --batch job (the jobs already use every core, and a job's
+    // errors must unwind on its own thread)
+    bool serial = worker || throwsOnExit();
+    region.workers = serial ? 1 : std::min(ThreadPool::instance().size(), region.chunkCount);
+    region.ranges.reset(new std::atomic<unsigned long long>[region.workers]());
+    for (size_t w = 0; w < region.workers; w++) {
+        unsigned long long front = region.chunkCount * w / region.workers;
+        unsigned long long back = region.chunkCount * (w + 1) / region.workers;
+        region.ranges[w].store((front << 32) | back, std::memory_order_relaxed);
+    }
+    region.partials.resize(region.chunkCount * reductionCount);
+
+    std::shared_ptr<Scope> shared = scope;
+    auto run = [&](size_t id) {
+        if (id >= region.workers) return;
+        ParallelWorker self(&region, id);
+        std::shared_ptr<Scope> workerScope;
+        {
+            MemTag tag(MEM_SCOPES);
+            workerScope = std::make_shared<Scope>(shared);
+        }
+        workerScope->isolate(&self);
+        Interpreter child(workerScope, &self);
+        child.hostCall = hostCall;
+
+        long long chunk;
+        while ((chunk = region.takeChunk(id)) >= 0) {
+            for (const auto& reduction : loop.reductions) {
+                workerScope->define(reduction.second.lexeme, reductionIdentity(reduction.first));
+            }
+
+            size_t begin = (size_t)chunk * region.chunkSize;
+            size_t end = std::min(iterations, begin + region.chunkSize);
+            for (size_t k = begin; k < end; k++) {
+                if (!loop.indexVar.lexeme.empty()) {
+                    workerScope->define(loop.indexVar.lexeme, Value(first + (long long)k));
+                }
+                if (items) workerScope->define(loop.valueVar.lexeme, (*items)[k]);
+                workerScope->setParallelIteration(k);
+                child.step();
+                child.scope = workerScope;
+                try {
+                    child.execute(loop.body);
+                } catch (ContinueSignal&) {
+                } catch (BreakSignal&) {
+                    std::cerr << "Runtime Error: stopdrim cannot leave a drimming parallel loop (line "
+                              << loop.line << ")\n";
+                    drimExit(1);
+                } catch (ReturnValue&) {
+                    std::cerr << "Runtime Error: return cannot leave a drimming parallel loop (line "
+                              << loop.line << ")\n";
+                    drimExit(1);
+                }
+            }
+
+            for (size_t r = 0; r < reductionCount; r++) {
+                region.partials[(size_t)chunk * reductionCount + r] = workerScope->get(loop.reductions[r].second);
+            }
+        }
+    };
+
+    if (serial) {
+        run(0);
+    } else {
+        OutputBuffer::enterConcurrent();
+        ThreadPool::instance().runOnAll(run);
+        OutputBuffer::leaveConcurrent();
+    }
+
+    for (size_t r = 0; r < reductionCount; r++) {
+        const auto& reduction = loop.reductions[r];
+        Value total = scope->get(reduction.second);
+        for (size_t c = 0; c < region.chunkCount; c++) {
+            total = combine(reduction.first, total, region.partials[c * reductionCount + r], reduction.second);
+        }
+        scope->assign(reduction.second, total);
+    }
+}
@@ -1,6 +1,10 @@
 #include "../include/Parser.h"
+#include "../include/Error.h"
+#include "../include/Optimizer.h"
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <charconv>
 
 // Constructor
 Parser::Parser(std::vector<Token> t) : tokens(t) {}
@@ -29,7 +33,7 @@ Token Parser::advance() {
 Token Parser::consume(TokenType type, std::string message) {
     if (peek().type == type) return advance();
     std::cerr << "Error: " << message << " on line " << peek().line << "\n";
-    exit(1);
+    drimExit(1);
 }
 
 // NEW HELPER
@@ -194,7 +198,9 @@ std::shared_ptr<Expr> Parser::primary() {
     }
 
     if (check(TOKEN_DOUBLE)) {
-        long double val = std::stold(advance().lexeme);
+        const std::string& text = advance().lexeme;
+        DrimFloat val = 0;
+        std::from_chars(text.data(), text.data() + text.size(), val);
         return std::make_shared<LiteralExpr>(val);
     }
 
@@ -211,12 +217,26 @@ std::shared_ptr<Expr> Parser::primary() {
         return std::make_shared<LiteralExpr>(false);
     }
 
+    // 'spawn' is only special in front of a call, so it stays usable as a name
+    if (check(TOKEN_IDENTIFIER) && peek().lexeme == "spawn" && peekAt(1).type == TOKEN_IDENTIFIER &&
+        peekAt(2).type == TOKEN_LPAREN) {
+        advance(); // consume 'spawn'
+        auto call = std::dynamic_pointer_cast<CallExpr>(primary());
+        return std::make_shared<SpawnExpr>(call);
+    }
+
     if (check(TOKEN_IDENTIFIER)) {
         Token name = advance();
 
         if (check(TOKEN_LBRACKET)) {
             advance(); // eat '['
-            std::shared_ptr<Expr> index = expression();
+            std::shared_ptr<Expr> index = check(TOKEN_COLON) ? nullptr : expression();
+            if (check(TOKEN_COLON)) {
+                advance(); // eat ':'
+                std::shared_ptr<Expr> end = check(TOKEN_RBRACKET) ? nullptr : expression();
+                consume(TOKEN_RBRACKET, "Expect ']' after array slice.");
+                return std::make_shared<ArraySliceExpr>(name, index, end);
+            }
             consume(TOKEN_RBRACKET, "Expect ']' after array index.");
             return std::make_shared<ArrayAccessExpr>(name, index);
         }
@@ -257,7 +277,7 @@ std::shared_ptr<Expr> Parser::primary() {
     }
 
     std::cerr << "Error: Expect expression on line " << peek().line << "\n";
-    exit(1);
+    drimExit(1);
 }
 
 
@@ -267,11 +287,21 @@ std::vector<std::shared_ptr<Stmt>> Parser::parse() {
         auto stmt = statement();
         if (stmt) commands.push_back(stmt);
     }
+    hoistLoopInvariants(commands);
+    inferTypes(commands);
     return commands;
 }
 
-// Decides what kind of statement we are looking at
+// Parses one statement and tags it with the line it starts on
 std::shared_ptr<Stmt> Parser::statement() {
+    int line = peek().line;
+    std::shared_ptr<Stmt> stmt = parseStatement();
+    if (stmt && stmt->line == 0) stmt->line = line;
+    return stmt;
+}
+
+// Decides what kind of statement we are looking at
+std::shared_ptr<Stmt> Parser::parseStatement() {
 
     //0. FUNCTION Declaration & Return Stmt
     if (check(KW_FUNC)) {
@@ -284,8 +314,11 @@ std::shared_ptr<Stmt> Parser::statement() {
 
     // 1. IF Statement
     if (check(KW_IF)) {
-        return ifStatement();
-
+        // Else-ifs parse recursively through ifStatement, so only the head
+        // of a chain gets here
+        auto head = ifStatement();
+        buildJumpTable(static_cast<IfStmt&>(*head));
+        return head;
     }
     // 1b. WHILE Statement (drimming)
     if (check(KW_DRIMMING)) {
@@ -312,12 +345,22 @@ std::shared_ptr<Stmt> Parser::statement() {
     // 3. INPUT (drim)
     if (check(KW_DRIM)) {
         advance(); consume(TOKEN_LPAREN, "Expect '('");
+        // Bulk form: drim(values[], n)
+        if (check(TOKEN_IDENTIFIER) && peekAt(1).type == TOKEN_LBRACKET && peekAt(2).type == TOKEN_RBRACKET) {
+            Token name = advance();
+            advance(); // consume '['
+            advance(); // consume ']'
+            consume(TOKEN_COMMA, "Expect ',' and a count after array in drim");
+            std::shared_ptr<Expr> count = expression();
+            consume(TOKEN_RPAREN, "Expect ')'");
+            return std::make_shared<ArrayInputStmt>(name, count);
+        }
         std::shared_ptr<Expr> target = expression();
         bool validTarget = std::dynamic_pointer_cast<VariableExpr>(target) != nullptr ||
                            std::dynamic_pointer_cast<ArrayAccessExpr>(target) != nullptr;
         if (!validTarget) {
             std::cerr << "Error: drim target must be a variable or array element on line " << peek().line << "\n";
-            exit(1);
+            drimExit(1);
         }
         consume(TOKEN_RPAREN, "Expect ')'");
         return std::make_shared<InputStmt>(target);
@@ -374,6 +417,7 @@ std::shared_ptr<Stmt> Parser::statement() {
             consume(TOKEN_ASSIGN, "Expect '=' after variable name");
             std::shared_ptr<Expr> nextValue = expression();
             stmts.push_back(std::make_shared<AssignStmt>(nextName, nextValue));
+            stmts.back()->line = nextName.line;
         }
 
         if (stmts.size() == 1) return stmts[0];
@@ -398,6 +442,7 @@ std::shared_ptr<Stmt> Parser::statement() {
 }
 
 std::shared_ptr<Stmt> Parser::ifStatement() {
+    int line = peek().line;
     consume(KW_IF, "Expect 'if'.");
 
     // Parse Condition
@@ -429,7 +474,77 @@ std::shared_ptr<Stmt> Parser::ifStatement() {
             elseBranch = std::make_shared<BlockStmt>(elseStmts);
         }
     }
-    return std::make_shared<IfStmt>(condition, thenBranch, elseBranch);
+    auto ifStmt = std::make_shared<IfStmt>(condition, thenBranch, elseBranch);
+    ifStmt->line = line;
+    return ifStmt;
+}
+
+// `name == constant` or `constant == name` with an int or plain string
+// constant (strings with {} or escapes are built at run time)
+static bool constantTest(const std::shared_ptr<Expr>& condition, Token& name, Value& constant) {
+    auto bin = std::dynamic_pointer_cast<BinaryExpr>(condition);
+    if (!bin || bin->op.type != TOKEN_EQUAL_EQUAL) return false;
+    auto var = std::dynamic_pointer_cast<VariableExpr>(bin->left);
+    auto lit = std::dynamic_pointer_cast<LiteralExpr>(bin->right);
+    if (!var || !lit) {
+        var = std::dynamic_pointer_cast<VariableExpr>(bin->right);
+        lit = std::dynamic_pointer_cast<LiteralExpr>(bin->left);
+    }
+    if (!var || !lit) return false;
+    auto s = std::get_if<std::string>(&lit->value.data);
+    if (!std::holds_alternative<long long>(lit->value.data) && !s) return false;
+    if (s && s->find_first_of("{\\") != std::string::npos) return false;
+    name = var->name;
+    constant = lit->value;
+    return true;
+}
+
+void Parser::buildJumpTable(IfStmt& head) {
+    // Shorter chains are as fast tested in turn
+    const size_t MIN_ARMS = 4;
+
+    auto table = std::make_shared<JumpTable>();
+    std::vector<Value> constants;
+    std::shared_ptr<Stmt> next;
+    for (IfStmt* arm = &head; arm; ) {
+        Token name;
+        Value constant;
+        if (!constantTest(arm->condition, name, constant)) return;
+        if (table->arms.empty()) table->subject = name;
+        else if (name.lexeme != table->subject.lexeme) return;
+        if (!constants.empty() && constants[0].data.index() != constant.data.index()) return;
+        constants.push_back(constant);
+        table->arms.push_back(arm->thenBranch);
+
+        next = arm->elseBranch;
+        arm = dynamic_cast<IfStmt*>(next.get());
+        if (!arm) table->otherwise = next;
+    }
+    if (table->arms.size() < MIN_ARMS) return;
+
+    // The first arm with a constant wins, as when testing in order
+    if (std::holds_alternative<std::string>(constants[0].data)) {
+        for (size_t i = 0; i < constants.size(); i++) {
+            table->strings.emplace(std::get<std::string>(constants[i].data), (int)i);
+        }
+    } else {
+        long long low = std::get<long long>(constants[0].data), high = low;
+        for (const auto& c : constants) {
+            low = std::min(low, std::get<long long>(c.data));
+            high = std::max(high, std::get<long long>(c.data));
+        }
+        bool dense = (unsigned long long)high - (unsigned long long)low < 4 * constants.size();
+        if (dense) {
+            table->low = low;
+            table->dense.assign((size_t)(high - low) + 1, -1);
+        }
+        for (size_t i = 0; i < constants.size(); i++) {
+            long long key = std::get<long long>(constants[i].data);
+            if (!dense) table->ints.emplace(key, (int)i);
+            else if (table->dense[(size_t)(key - low)] < 0) table->dense[(size_t)(key - low)] = (int)i;
+        }
+    }
+    head.jumpTable = table;
 }
 
 std::vector<std::shared_ptr<Stmt>> Parser::block() {
@@ -447,6 +562,12 @@ std::vector<std::shared_ptr<Stmt>> Parser::block() {
 std::shared_ptr<Stmt> Parser::whileStatement() {
     consume(KW_DRIMMING, "Expect 'drimming'.");
 
+    // 'parallel' and 'in' are only special here, so they stay usable as names
+    if (check(TOKEN_IDENTIFIER) && peek().lexeme == "parallel" && peekAt(1).type == TOKEN_IDENTIFIER &&
+        (peekAt(2).type == TOKEN_COMMA || (peekAt(2).type == TOKEN_IDENTIFIER && peekAt(2).lexeme == "in"))) {
+        return parallelForStatement();
+    }
+
     // Parse condition (e.g. "i <= 10 and j <= 30")
     std::shared_ptr<Expr> condition = expression();
 
@@ -457,6 +578,71 @@ std::shared_ptr<Stmt> Parser::whileStatement() {
 
     return std::make_shared<WhileStmt>(condition, body);
 }
+std::shared_ptr<Stmt> Parser::parallelForStatement() {
+    advance(); // consume 'parallel'
+    Token first = consume(TOKEN_IDENTIFIER, "Expect loop variable after 'parallel'.");
+    Token none = {TOKEN_IDENTIFIER, "", first.line};
+    Token second = none;
+    if (check(TOKEN_COMMA)) {
+        advance();
+        second = consume(TOKEN_IDENTIFIER, "Expect element variable after ','.");
+    }
+    if (!(check(TOKEN_IDENTIFIER) && peek().lexeme == "in")) {
+        std::cerr << "Error: Expect 'in' after loop variable on line " << peek().line << "\n";
+        drimExit(1);
+    }
+    advance(); // consume 'in'
+
+    std::shared_ptr<Expr> start = expression();
+    std::shared_ptr<Expr> end = nullptr;
+    Token arrayName = none;
+    Token indexVar = first;
+    Token valueVar = none;
+
+    if (check(TOKEN_DOT_DOT)) {
+        advance();
+        end = expression();
+        if (!second.lexeme.empty()) {
+            std::cerr << "Error: A range binds a single loop variable on line " << first.line << "\n";
+            drimExit(1);
+        }
+    } else {
+        auto arr = std::dynamic_pointer_cast<VariableExpr>(start);
+        if (!arr) {
+            std::cerr << "Error: Expect a range 'a..b' or an array name after 'in' on line " << first.line << "\n";
+            drimExit(1);
+        }
+        arrayName = arr->name;
+        start = nullptr;
+        if (second.lexeme.empty()) {
+            indexVar = none;
+            valueVar = first;
+        } else {
+            valueVar = second;
+        }
+    }
+
+    std::vector<std::pair<TokenType, Token>> reductions;
+    if (check(TOKEN_IDENTIFIER) && peek().lexeme == "reduce") {
+        advance();
+        consume(TOKEN_LPAREN, "Expect '(' after 'reduce'.");
+        do {
+            Token op = advance();
+            if (op.type != TOKEN_PLUS && op.type != TOKEN_STAR && op.type != TOKEN_BIT_AND && op.type != TOKEN_BIT_OR) {
+                std::cerr << "Error: reduce supports +, *, & and | on line " << op.line << "\n";
+                drimExit(1);
+            }
+            consume(TOKEN_COLON, "Expect ':' after reduction operator.");
+            reductions.push_back({op.type, consume(TOKEN_IDENTIFIER, "Expect variable name in reduce.")});
+        } while (check(TOKEN_COMMA) && advance().type == TOKEN_COMMA);
+        consume(TOKEN_RPAREN, "Expect ')' after reduce clause.");
+    }
+
+    consume(TOKEN_LBRACE, "Expect '{' after drimming parallel header.");
+    std::shared_ptr<Stmt> body = std::make_shared<BlockStmt>(block());
+    return std::make_shared<ParallelForStmt>(indexVar, valueVar, start, end, arrayName, reductions, body);
+}
+
 std::shared_ptr<Stmt> Parser::functionDeclaration() {
     advance(); // consume "func"
     Token name = consume(TOKEN_IDENTIFIER, "Expect function name.");
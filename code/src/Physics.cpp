@@ -1,14 +1,15 @@
 #include "../include/Physics.h"
+#include "../include/Error.h"
 #include <iostream>
 #include <cmath>
 #include <variant>
 
-// Helper to get long double args
-long double getNum(const Value* args, size_t count, size_t index) {
+// Helper to get numeric args as floats
+DrimFloat getNum(const Value* args, size_t count, size_t index) {
     if (index >= count) return 0.0;
     const Value& v = args[index];
-    if (auto i = std::get_if<long long>(&v.data)) return (long double)*i;
-    if (auto d = std::get_if<long double>(&v.data)) return *d;
+    if (auto i = std::get_if<long long>(&v.data)) return (DrimFloat)*i;
+    if (auto d = std::get_if<DrimFloat>(&v.data)) return *d;
     return 0.0;
 }
 
@@ -17,41 +18,41 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "speed") {
         if (count != 2) { 
             std::cerr << "Error: speed(distance, time) expects 2 arguments.\n"; 
-            exit(1); 
+            drimExit(1); 
         }
-        long double d = getNum(args, count, 0);
-        long double t = getNum(args, count, 1);
-        if (t == 0) return 0.0L;
+        DrimFloat d = getNum(args, count, 0);
+        DrimFloat t = getNum(args, count, 1);
+        if (t == 0) return DrimFloat(0.0L);
         return d / t;
     }
 
     if (name == "velocity") {
         if (count != 2) { 
             std::cerr << "Error: velocity(displacement, time) expects 2 arguments.\n"; 
-            exit(1); 
+            drimExit(1); 
         }
-        long double d = getNum(args, count, 0);
-        long double t = getNum(args, count, 1);
-        if (t == 0) return 0.0L;
+        DrimFloat d = getNum(args, count, 0);
+        DrimFloat t = getNum(args, count, 1);
+        if (t == 0) return DrimFloat(0.0L);
         return d / t;
     }
 
     if (name == "acceleration") {
         if (count != 3) { 
             std::cerr << "Error: acceleration(vf, vi, t) expects 3 arguments.\n"; 
-            exit(1); 
+            drimExit(1); 
         }
-        long double vf = getNum(args, count, 0);
-        long double vi = getNum(args, count, 1);
-        long double t = getNum(args, count, 2);
-        if (t == 0) return 0.0L;
+        DrimFloat vf = getNum(args, count, 0);
+        DrimFloat vi = getNum(args, count, 1);
+        DrimFloat t = getNum(args, count, 2);
+        if (t == 0) return DrimFloat(0.0L);
         return (vf - vi) / t;
     }
 
     if (name == "distance") {
         if (count != 2) { 
              std::cerr << "Error: distance(speed, time) expects 2 arguments.\n"; 
-             exit(1);
+             drimExit(1);
         }
         return getNum(args, count, 0) * getNum(args, count, 1);
     }
@@ -59,11 +60,11 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "final_velocity") {
         if (count != 3) {
             std::cerr << "Error: final_velocity(u, a, t) expects 3 arguments.\n";
-            exit(1);
+            drimExit(1);
         }
-        long double u = getNum(args, count, 0);
-        long double a = getNum(args, count, 1);
-        long double t = getNum(args, count, 2);
+        DrimFloat u = getNum(args, count, 0);
+        DrimFloat a = getNum(args, count, 1);
+        DrimFloat t = getNum(args, count, 2);
         return u + (a * t);
     }
 
@@ -71,7 +72,7 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "force") {
         if (count != 2) {
              std::cerr << "Error: force(m, a) expects 2 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
         return getNum(args, count, 0) * getNum(args, count, 1);
     }
@@ -79,7 +80,7 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "weight") {
         if (count != 2) {
              std::cerr << "Error: weight(m, g) expects 2 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
         return getNum(args, count, 0) * getNum(args, count, 1);
     }
@@ -87,18 +88,18 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "pressure") {
         if (count != 2) {
              std::cerr << "Error: pressure(F, A) expects 2 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
-        long double F = getNum(args, count, 0);
-        long double A = getNum(args, count, 1);
-        if (A == 0) return 0.0L;
+        DrimFloat F = getNum(args, count, 0);
+        DrimFloat A = getNum(args, count, 1);
+        if (A == 0) return DrimFloat(0.0L);
         return F / A;
     }
 
     if (name == "momentum") {
         if (count != 2) {
              std::cerr << "Error: momentum(m, v) expects 2 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
         return getNum(args, count, 0) * getNum(args, count, 1);
     }
@@ -106,7 +107,7 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "impulse") {
         if (count != 2) {
              std::cerr << "Error: impulse(F, t) expects 2 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
         return getNum(args, count, 0) * getNum(args, count, 1);
     }
@@ -115,7 +116,7 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "work") {
         if (count != 2) {
              std::cerr << "Error: work(F, d) expects 2 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
         return getNum(args, count, 0) * getNum(args, count, 1);
     }
@@ -123,17 +124,17 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "kinetic_energy") {
         if (count != 2) {
              std::cerr << "Error: kinetic_energy(m, v) expects 2 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
-        long double m = getNum(args, count, 0);
-        long double v = getNum(args, count, 1);
-        return 0.5L * m * v * v;
+        DrimFloat m = getNum(args, count, 0);
+        DrimFloat v = getNum(args, count, 1);
+        return DrimFloat(0.5L) * m * v * v;
     }
 
     if (name == "potential_energy") {
         if (count != 3) {
              std::cerr << "Error: potential_energy(m, g, h) expects 3 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
         return getNum(args, count, 0) * getNum(args, count, 1) * getNum(args, count, 2);
     }
@@ -141,11 +142,11 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "power") {
         if (count != 2) {
              std::cerr << "Error: power(W, t) expects 2 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
-        long double W = getNum(args, count, 0);
-        long double t = getNum(args, count, 1);
-        if (t == 0) return 0.0L;
+        DrimFloat W = getNum(args, count, 0);
+        DrimFloat t = getNum(args, count, 1);
+        if (t == 0) return DrimFloat(0.0L);
         return W / t;
     }
 
@@ -153,30 +154,30 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "centripetal_force") {
         if (count != 3) {
              std::cerr << "Error: centripetal_force(m, v, r) expects 3 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
-        long double m = getNum(args, count, 0);
-        long double v = getNum(args, count, 1);
-        long double r = getNum(args, count, 2);
-        if (r == 0) return 0.0L;
+        DrimFloat m = getNum(args, count, 0);
+        DrimFloat v = getNum(args, count, 1);
+        DrimFloat r = getNum(args, count, 2);
+        if (r == 0) return DrimFloat(0.0L);
         return (m * v * v) / r;
     }
 
     if (name == "angular_speed") {
         if (count != 1) {
              std::cerr << "Error: angular_speed(T) expects 1 argument.\n";
-             exit(1);
+             drimExit(1);
         }
-        long double T = getNum(args, count, 0);
-        if (T == 0) return 0.0L;
-        return (2.0L * 3.14159265358979323846L) / T;
+        DrimFloat T = getNum(args, count, 0);
+        if (T == 0) return DrimFloat(0.0L);
+        return (DrimFloat(2.0L) * DrimFloat(3.14159265358979323846L)) / T;
     }
 
     // 5. Electricity
     if (name == "voltage") {
         if (count != 2) {
              std::cerr << "Error: voltage(I, R) expects 2 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
         return getNum(args, count, 0) * getNum(args, count, 1);
     }
@@ -184,18 +185,18 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "current") {
         if (count != 2) {
              std::cerr << "Error: current(V, R) expects 2 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
-        long double V = getNum(args, count, 0);
-        long double R = getNum(args, count, 1);
-        if (R == 0) return 0.0L;
+        DrimFloat V = getNum(args, count, 0);
+        DrimFloat R = getNum(args, count, 1);
+        if (R == 0) return DrimFloat(0.0L);
         return V / R;
     }
 
     if (name == "electrical_power") {
         if (count != 2) {
              std::cerr << "Error: electrical_power(V, I) expects 2 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
         return getNum(args, count, 0) * getNum(args, count, 1);
     }
@@ -203,7 +204,7 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "electrical_energy") {
         if (count != 2) {
              std::cerr << "Error: electrical_energy(P, t) expects 2 arguments.\n";
-             exit(1);
+             drimExit(1);
         }
         return getNum(args, count, 0) * getNum(args, count, 1);
     }
@@ -212,7 +213,7 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "wave_speed") {
         if (count != 2) {
              std::cerr << "Error: wave_speed(f, lambda) expects 2 arguments.\n"; 
-             exit(1);
+             drimExit(1);
         }
         return getNum(args, count, 0) * getNum(args, count, 1);
     }
@@ -220,18 +221,18 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "frequency") {
         if (count != 1) {
              std::cerr << "Error: frequency(T) expects 1 argument.\n"; 
-             exit(1);
+             drimExit(1);
         }
-        long double T = getNum(args, count, 0);
-        if (T == 0) return 0.0L;
-        return 1.0L / T;
+        DrimFloat T = getNum(args, count, 0);
+        if (T == 0) return DrimFloat(0.0L);
+        return DrimFloat(1.0L) / T;
     }
 
     // 7. Heat & Thermodynamics
     if (name == "heat_energy") {
         if (count != 3) {
              std::cerr << "Error: heat_energy(m, c, deltaT) expects 3 arguments.\n"; 
-             exit(1);
+             drimExit(1);
         }
         return getNum(args, count, 0) * getNum(args, count, 1) * getNum(args, count, 2);
     }
@@ -239,29 +240,29 @@ Value execPhysics(const std::string& name, const Value* args, size_t count) {
     if (name == "to_kelvin") {
         if (count != 1) {
              std::cerr << "Error: to_kelvin(c) expects 1 argument.\n"; 
-             exit(1);
+             drimExit(1);
         }
-        return getNum(args, count, 0) + 273.15L;
+        return getNum(args, count, 0) + DrimFloat(273.15L);
     }
 
     if (name == "to_fahrenheit") {
         if (count != 1) {
              std::cerr << "Error: to_fahrenheit(c) expects 1 argument.\n"; 
-             exit(1);
+             drimExit(1);
         }
-        return (getNum(args, count, 0) * 1.8L) + 32.0L;
+        return (getNum(args, count, 0) * DrimFloat(1.8L)) + DrimFloat(32.0L);
     }
 
     if (name == "mass_energy") {
         if (count != 1) {
              std::cerr << "Error: mass_energy(m) expects 1 argument.\n"; 
-             exit(1);
+             drimExit(1);
         }
-        long double m = getNum(args, count, 0);
-        long double c = 299792458.0L; 
+        DrimFloat m = getNum(args, count, 0);
+        DrimFloat c = DrimFloat(299792458.0L); 
         return m * c * c;
     }
 
     std::cerr << "Runtime Error: Unknown function '" << name << "'\n";
-    exit(1);
+    drimExit(1);
 }
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "../include/Profiler.h"
+#include "../include/AST.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+Profiler* activeProfiler = nullptr;
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else out += c;
+    }
+    return out;
+}
+
+std::string trimmed(const std::string& text, size_t width) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) return "";
+    std::string out = text.substr(first);
+    if (out.size() > width) out = out.substr(0, width - 3) + "...";
+    return out;
+}
+}
+
+Profiler::Profiler(const std::string& path, const std::string& source) : jsonPath(path) {
+    std::stringstream in(source);
+    std::string line;
+    sourceLines.push_back(""); // lines are 1-based
+    while (std::getline(in, line)) sourceLines.push_back(line);
+    lines.resize(sourceLines.size() + 1);
+    lineStack.reserve(256);
+    callStack.reserve(256);
+}
+
+// Lives until exit so the report also runs after a runtime error's exit(1)
+Profiler& Profiler::start(const std::string& jsonPath, const std::string& source) {
+    activeProfiler = new Profiler(jsonPath, source);
+    std::atexit([] { activeProfiler->report(); });
+    return *activeProfiler;
+}
+
+void Profiler::enterLine(int line) {
+    if ((size_t)line >= lines.size()) lines.resize(line + 1);
+    lines[line].count++;
+    lineStack.push_back({now(), 0, line});
+}
+
+void Profiler::leaveLine() {
+    LineFrame frame = lineStack.back();
+    lineStack.pop_back();
+    uint64_t elapsed = now() - frame.start;
+    lines[frame.line].selfNs += elapsed - frame.childNs;
+    if (!lineStack.empty()) lineStack.back().childNs += elapsed;
+}
+
+void Profiler::enterCall(const FunctionStmt* func) {
+    FuncStats& stats = functions[func];
+    if (stats.calls == 0) {
+        stats.name = func->name.lexeme;
+        stats.line = func->name.line;
+    }
+    stats.calls++;
+    stats.active++;
+    callStack.push_back({now(), 0, &stats});
+}
+
+void Profiler::leaveCall() {
+    CallFrame frame = callStack.back();
+    callStack.pop_back();
+    uint64_t elapsed = now() - frame.start;
+    FuncStats& stats = *frame.stats;
+    stats.exclusiveNs += elapsed - frame.childNs;
+    if (--stats.active == 0) stats.inclusiveNs += elapsed;
+    if (!callStack.empty()) callStack.back().childNs += elapsed;
+}
+
+void Profiler::report() {
+    // Frames still open when exit() ran (runtime error) are closed here
+    while (!lineStack.empty()) leaveLine();
+    while (!callStack.empty()) leaveCall();
+
+    std::vector<std::pair<const FunctionStmt*, FuncStats>> funcs(functions.begin(), functions.end());
+    std::sort(funcs.begin(), funcs.end(), [](const auto& a, const auto& b) {
+        return a.second.inclusiveNs > b.second.inclusiveNs;
+    });
+
+    std::vector<int> hotLines;
+    for (size_t i = 1; i < lines.size(); i++) {
+        if (lines[i].count) hotLines.push_back((int)i);
+    }
+    std::sort(hotLines.begin(), hotLines.end(), [this](int a, int b) {
+        return lines[a].selfNs > lines[b].selfNs;
+    });
+
+    std::cout.flush();
+    char row[256];
+    std::cerr << "\n=== drim profile: functions (by inclusive time) ===\n";
+    std::snprintf(row, sizeof(row), "%-24s %6s %12s %14s %14s\n", "function", "line", "calls", "inclusive ms", "exclusive ms");
+    std::cerr << row;
+    for (size_t i = 0; i < funcs.size() && i < 10; i++) {
+        const FuncStats& s = funcs[i].second;
+        std::snprintf(row, sizeof(row), "%-24s %6d %12llu %14.3f %14.3f\n",
+                      s.name.c_str(), s.line,
+                      (unsigned long long)s.calls, s.inclusiveNs / 1e6, s.exclusiveNs / 1e6);
+        std::cerr << row;
+    }
+
+    std::cerr << "\n=== drim profile: lines (by self time) ===\n";
+    std::snprintf(row, sizeof(row), "%6s %12s %12s  %s\n", "line", "count", "self ms", "source");
+    std::cerr << row;
+    for (size_t i = 0; i < hotLines.size() && i < 10; i++) {
+        int line = hotLines[i];
+        std::string text = (size_t)line < sourceLines.size() ? trimmed(sourceLines[line], 48) : "";
+        std::snprintf(row, sizeof(row), "%6d %12llu %12.3f  %s\n", line,
+                      (unsigned long long)lines[line].count, lines[line].selfNs / 1e6, text.c_str());
+        std::cerr << row;
+    }
+
+    std::ofstream json(jsonPath);
+    if (!json.is_open()) {
+        std::cerr << "Warning: could not write profile to '" << jsonPath << "'\n";
+        return;
+    }
+    json << "{\n  \"functions\": [";
+    for (size_t i = 0; i < funcs.size(); i++) {
+        const FuncStats& s = funcs[i].second;
+        json << (i ? ",\n" : "\n") << "    {\"name\": \"" << jsonEscape(s.name)
+             << "\", \"line\": " << s.line << ", \"calls\": " << s.calls
+             << ", \"inclusive_ns\": " << s.inclusiveNs << ", \"exclusive_ns\": " << s.exclusiveNs << "}";
+    }
+    json << "\n  ],\n  \"lines\": [";
+    for (size_t i = 0; i < hotLines.size(); i++) {
+        int line = hotLines[i];
+        std::string text = (size_t)line < sourceLines.size() ? trimmed(sourceLines[line], 120) : "";
+        json << (i ? ",\n" : "\n") << "    {\"line\": " << line << ", \"count\": " << lines[line].count
+             << ", \"self_ns\": " << lines[line].selfNs << ", \"source\": \"" << jsonEscape(text) << "\"}";
+    }
+    json << "\n  ]\n}\n";
+    std::cerr << "Profile written to " << jsonPath << "\n";
+}
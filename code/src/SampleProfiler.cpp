@@ -0,0 +1,144 @@
+#include "../include/SampleProfiler.h"
+#include "../include/AST.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <sys/time.h>
+#define DRIM_SAMPLING_AVAILABLE 1
+#else
+#define DRIM_SAMPLING_AVAILABLE 0
+#endif
+
+namespace {
+SampleProfiler* activeSampler = nullptr;
+#if DRIM_SAMPLING_AVAILABLE
+pthread_t profiledThread;
+#endif
+}
+
+bool SampleProfiler::supported() {
+    return DRIM_SAMPLING_AVAILABLE;
+}
+
+SampleProfiler::SampleProfiler(int hz, const std::string& outPath)
+    : outPath(outPath), hz(hz < 1 ? 1 : hz) {
+    frames[0] = {nullptr, 0};
+    buckets = new Bucket[BUCKETS]();
+    pool = new Frame[POOL];
+}
+
+// Lives until exit; finish() runs from main, or from atexit after exit(1)
+SampleProfiler& SampleProfiler::start(int hz, const std::string& outPath) {
+    activeSampler = new SampleProfiler(hz, outPath);
+    std::atexit([] { activeSampler->finish(); });
+
+#if DRIM_SAMPLING_AVAILABLE
+    profiledThread = pthread_self();
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = &SampleProfiler::onSignal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPROF, &sa, nullptr);
+
+    struct itimerval timer;
+    long usec = 1000000L / activeSampler->hz;
+    if (usec < 1) usec = 1;
+    timer.it_interval.tv_sec = usec / 1000000L;
+    timer.it_interval.tv_usec = usec % 1000000L;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+#endif
+    return *activeSampler;
+}
+
+void SampleProfiler::blockSignal() {
+#if DRIM_SAMPLING_AVAILABLE
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+#endif
+}
+
+void SampleProfiler::onSignal(int) {
+#if DRIM_SAMPLING_AVAILABLE
+    // A thread that does not block SIGPROF (server workers, host threads)
+    // must not touch the tables the main thread's samples go to
+    if (!pthread_equal(pthread_self(), profiledThread)) return;
+#endif
+    if (activeSampler) activeSampler->record();
+}
+
+// Runs inside the signal handler: no allocation, no locks, no I/O
+void SampleProfiler::record() {
+    int d = depth;
+    std::atomic_signal_fence(std::memory_order_acquire);
+    if (d > MAX_DEPTH) d = MAX_DEPTH;
+
+    uint64_t hash = 1469598103934665603ULL;
+    for (int i = 0; i < d; i++) {
+        hash = (hash ^ (uint64_t)(uintptr_t)frames[i].func) * 1099511628211ULL;
+        hash = (hash ^ (uint64_t)frames[i].line) * 1099511628211ULL;
+    }
+
+    for (size_t probe = 0; probe < BUCKETS; probe++) {
+        Bucket& b = buckets[(hash + probe) & (BUCKETS - 1)];
+        if (b.count == 0) {
+            if (poolUsed + d > POOL) break;
+            std::memcpy(pool + poolUsed, frames, sizeof(Frame) * d);
+            b.hash = hash;
+            b.depth = (uint32_t)d;
+            b.offset = (uint32_t)poolUsed;
+            poolUsed += d;
+            b.count = 1;
+            return;
+        }
+        if (b.hash == hash && b.depth == (uint32_t)d &&
+            std::memcmp(pool + b.offset, frames, sizeof(Frame) * d) == 0) {
+            b.count++;
+            return;
+        }
+    }
+    dropped++;
+}
+
+void SampleProfiler::finish() {
+    if (finished) return;
+    finished = true;
+
+#if DRIM_SAMPLING_AVAILABLE
+    struct itimerval off;
+    std::memset(&off, 0, sizeof(off));
+    setitimer(ITIMER_PROF, &off, nullptr);
+    signal(SIGPROF, SIG_IGN);
+#endif
+
+    std::ofstream out(outPath);
+    if (!out.is_open()) {
+        std::cerr << "Warning: could not write samples to '" << outPath << "'\n";
+        return;
+    }
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        const Bucket& b = buckets[i];
+        if (b.count == 0) continue;
+        total += b.count;
+        for (uint32_t f = 0; f < b.depth; f++) {
+            const Frame& frame = pool[b.offset + f];
+            if (f) out << ';';
+            out << (frame.func ? frame.func->name.lexeme.c_str() : "<main>") << ':' << frame.line;
+        }
+        out << ' ' << b.count << '\n';
+    }
+
+    std::cout.flush();
+    std::cerr << "Sampled " << total << " stacks at " << hz << " Hz into " << outPath;
+    if (dropped) std::cerr << " (" << dropped << " dropped, tables full)";
+    std::cerr << "\n";
+}
@@ -0,0 +1,127 @@
+#include "../include/ScriptBench.h"
+#include "../include/Lexer.h"
+#include "../include/Parser.h"
+#include "../include/Interpreter.h"
+#include "../include/Output.h"
+#include "../include/Input.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+enum Phase { PHASE_READ, PHASE_LEX, PHASE_PARSE, PHASE_INTERPRET, PHASE_TOTAL, PHASE_COUNT };
+const char* phaseNames[PHASE_COUNT] = {"read", "lex", "parse", "interpret", "total"};
+
+double nowMs() {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Peak resident set size of the process in KiB, 0 if unknown
+long peakRssKb() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+bool readFile(const std::string& path, std::string& out) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    out = buffer.str();
+    return true;
+}
+
+// One full read -> lex -> parse -> interpret pass
+void runOnce(const std::string& scriptPath, const ScriptBenchOptions& options,
+             const std::string& input, double times[PHASE_COUNT]) {
+    InputBuffer::instance().replay(input);
+
+    double t0 = nowMs();
+    std::string source;
+    if (!readFile(scriptPath, source)) {
+        std::cerr << "Error: Could not open file.\n";
+        exit(1);
+    }
+    double t1 = nowMs();
+
+    Lexer lexer(source);
+    lexer.scanTokens();
+    double t2 = nowMs();
+
+    Parser parser(lexer.tokens);
+    auto commands = parser.parse();
+    double t3 = nowMs();
+
+    {
+        Interpreter interpreter;
+        if (options.useJit) interpreter.enableJit(options.jitThreshold);
+        try {
+            interpreter.interpret(commands);
+        } catch (ReturnValue&) {
+        }
+    }
+    double t4 = nowMs();
+
+    times[PHASE_READ] = t1 - t0;
+    times[PHASE_LEX] = t2 - t1;
+    times[PHASE_PARSE] = t3 - t2;
+    times[PHASE_INTERPRET] = t4 - t3;
+    times[PHASE_TOTAL] = t4 - t0;
+}
+}
+
+int runScriptBench(const std::string& scriptPath, const ScriptBenchOptions& options) {
+    std::string input;
+    if (!options.inputPath.empty() && !readFile(options.inputPath, input)) {
+        std::cerr << "Error: Could not open bench input file.\n";
+        return 1;
+    }
+
+    int runs = std::max(1, options.runs);
+    std::vector<double> samples[PHASE_COUNT];
+    double times[PHASE_COUNT];
+
+    OutputBuffer& out = OutputBuffer::instance();
+    out.setDiscard(true);
+    for (int i = 0; i < options.warmup; i++) runOnce(scriptPath, options, input, times);
+    for (int i = 0; i < runs; i++) {
+        runOnce(scriptPath, options, input, times);
+        for (int p = 0; p < PHASE_COUNT; p++) samples[p].push_back(times[p]);
+    }
+    out.setDiscard(false);
+
+    char row[128];
+    std::cout << "drim bench: " << scriptPath << ", " << runs << " runs after "
+              << options.warmup << " warmup\n";
+    std::snprintf(row, sizeof(row), "%-10s %12s %12s %12s\n", "phase", "min ms", "median ms", "p99 ms");
+    std::cout << row;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        std::vector<double>& s = samples[p];
+        std::sort(s.begin(), s.end());
+        size_t p99 = std::min(s.size() - 1, (s.size() * 99 + 99) / 100 - 1);
+        std::snprintf(row, sizeof(row), "%-10s %12.3f %12.3f %12.3f\n", phaseNames[p], s.front(), s[s.size() / 2], s[p99]);
+        std::cout << row;
+    }
+    std::snprintf(row, sizeof(row), "peak RSS   %12.1f MB\n", peakRssKb() / 1024.0);
+    std::cout << row;
+    std::cout.flush();
+    return 0;
+}
@@ -0,0 +1,313 @@
+#include "../include/Server.h"
+#include "../include/Drim.h"
+#include "../include/ThreadPool.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <csignal>
+#include <climits>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define DRIM_SOCKETS 1
+#else
+#define DRIM_SOCKETS 0
+#endif
+
+#if DRIM_SOCKETS
+
+// Wire format, all lengths little-endian uint32:
+//   request:  [len][script path][len][stdin]
+//   response: frames of [tag][len][bytes], tag 'O' stdout, 'E' stderr,
+//             then a final 'X' frame whose 4 bytes are the exit status
+namespace {
+
+// Lengths come from the client, so they are checked before anything is allocated
+const uint32_t MAX_PATH_BYTES = PATH_MAX;
+const uint32_t MAX_INPUT_BYTES = 64u << 20;
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+bool readAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::read(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+void putLength(std::string& out, uint32_t n) {
+    char bytes[4] = {(char)(n & 0xff), (char)((n >> 8) & 0xff), (char)((n >> 16) & 0xff), (char)(n >> 24)};
+    out.append(bytes, 4);
+}
+
+bool readLength(int fd, uint32_t& n) {
+    unsigned char bytes[4];
+    if (!readAll(fd, (char*)bytes, 4)) return false;
+    n = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    return true;
+}
+
+bool readField(int fd, std::string& out, uint32_t limit, bool& tooLarge) {
+    uint32_t n;
+    if (!readLength(fd, n)) return false;
+    if (n > limit) {
+        tooLarge = true;
+        return false;
+    }
+    out.resize(n);
+    return readAll(fd, &out[0], n);
+}
+
+void putFrame(std::string& out, char tag, const std::string& bytes) {
+    out.push_back(tag);
+    putLength(out, (uint32_t)bytes.size());
+    out += bytes;
+}
+
+bool fillAddress(const std::string& path, sockaddr_un& addr) {
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Error: Socket path is too long: " << path << "\n";
+        return false;
+    }
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Compiled scripts by path, recompiled when the file's size or mtime changes
+class ProgramCache {
+public:
+    std::shared_ptr<const drim::Program> get(const std::string& path, std::string& error) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            error = "Error: Could not open file.\n";
+            return nullptr;
+        }
+        long long stamp = (long long)st.st_mtime * 1000000000LL + mtimeNanos(st);
+
+        std::lock_guard<std::mutex> guard(lock);
+        Entry& entry = entries[path];
+        if (!entry.program || entry.size != (long long)st.st_size || entry.stamp != stamp) {
+            entry.program = drim::Program::compileFile(path, &entry.error);
+            entry.size = (long long)st.st_size;
+            entry.stamp = stamp;
+        }
+        error = entry.error;
+        return entry.program;
+    }
+
+private:
+    struct Entry {
+        std::shared_ptr<const drim::Program> program;
+        std::string error;
+        long long size = -1;
+        long long stamp = -1;
+    };
+    std::mutex lock;
+    std::map<std::string, Entry> entries;
+
+    static long long mtimeNanos(const struct stat& st) {
+#if defined(__APPLE__)
+        return st.st_mtimespec.tv_nsec;
+#else
+        return st.st_mtim.tv_nsec;
+#endif
+    }
+};
+
+void sendError(int fd, const std::string& message) {
+    std::string reply;
+    putFrame(reply, 'E', message);
+    reply.push_back('X');
+    putLength(reply, 1);
+    writeAll(fd, reply.data(), reply.size());
+}
+
+void serveConnection(int fd, ProgramCache& cache) {
+    std::string path, input;
+    bool tooLarge = false;
+    if (!readField(fd, path, MAX_PATH_BYTES, tooLarge) || !readField(fd, input, MAX_INPUT_BYTES, tooLarge)) {
+        if (tooLarge) sendError(fd, "Error: Request too large\n");
+        return;
+    }
+
+    std::string reply;
+    std::string error;
+    int status = 1;
+    std::shared_ptr<const drim::Program> program = cache.get(path, error);
+    if (!program) {
+        // Same streams the CLI uses for these two errors
+        putFrame(reply, error == "Error: Could not open file.\n" ? 'O' : 'E', error);
+    } else {
+        // Output goes out in frames while the script runs; a client that
+        // went away just stops receiving them
+        drim::Instance vm(program);
+        vm.setInput(input);
+        vm.streamOutput([fd](const std::string& text, bool isError) {
+            std::string frame;
+            putFrame(frame, isError ? 'E' : 'O', text);
+            writeAll(fd, frame.data(), frame.size());
+        });
+        status = vm.run().status;
+    }
+    reply.push_back('X');
+    putLength(reply, (uint32_t)status);
+    writeAll(fd, reply.data(), reply.size());
+}
+
+std::string socketToRemove;
+
+void removeSocket(int) {
+    if (!socketToRemove.empty()) unlink(socketToRemove.c_str());
+    _exit(0);
+}
+
+}
+
+int runServer(const std::string& socketPath) {
+    sockaddr_un addr;
+    if (!fillAddress(socketPath, addr)) return 1;
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        std::cerr << "Error: Could not create socket: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    unlink(socketPath.c_str()); // a stale socket from a previous server
+    if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 128) != 0) {
+        std::cerr << "Error: Could not listen on " << socketPath << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    socketToRemove = socketPath;
+    std::signal(SIGINT, removeSocket);
+    std::signal(SIGTERM, removeSocket);
+    std::signal(SIGPIPE, SIG_IGN); // a client that goes away must not kill us
+
+    size_t workers = ThreadPool::instance().configuredSize();
+    std::cerr << "drim: serving on " << socketPath << " with " << workers << " workers\n";
+
+    // Every worker blocks in accept() on the shared socket; the kernel hands
+    // each connection to exactly one of them, so no queue is needed
+    ProgramCache cache;
+    auto work = [&] {
+        while (true) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                std::cerr << "Error: accept failed: " << std::strerror(errno) << "\n";
+                _exit(1);
+            }
+            // One request running out of memory must not take the server down
+            try {
+                serveConnection(fd, cache);
+            } catch (const std::exception& e) {
+                sendError(fd, std::string("Error: ") + e.what() + "\n");
+            }
+            close(fd);
+        }
+    };
+    for (size_t i = 1; i < workers; i++) std::thread(work).detach();
+    work();
+    return 0;
+}
+
+int runClient(const std::string& socketPath, const std::string& scriptPath) {
+    sockaddr_un addr;
+    if (!fillAddress(socketPath, addr)) return 1;
+
+    // The server has its own working directory
+    char resolved[PATH_MAX];
+    std::string path = realpath(scriptPath.c_str(), resolved) ? resolved : scriptPath;
+
+    // drim() input is sent up front; a terminal has none to send
+    std::string input;
+    if (!isatty(STDIN_FILENO)) {
+        char chunk[1 << 16];
+        ssize_t n;
+        while ((n = ::read(STDIN_FILENO, chunk, sizeof(chunk))) != 0) {
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            input.append(chunk, (size_t)n);
+        }
+    }
+    if (path.size() > MAX_PATH_BYTES || input.size() > MAX_INPUT_BYTES) {
+        std::cerr << "Error: The script path or drim() input is too large to send to the server\n";
+        return 1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        std::cerr << "Error: Could not connect to drim server at " << socketPath << ": "
+                  << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    std::string request;
+    putLength(request, (uint32_t)path.size());
+    request += path;
+    putLength(request, (uint32_t)input.size());
+    request += input;
+    if (!writeAll(fd, request.data(), request.size())) {
+        std::cerr << "Error: Lost connection to drim server\n";
+        return 1;
+    }
+
+    while (true) {
+        char tag;
+        uint32_t n;
+        if (!readAll(fd, &tag, 1) || !readLength(fd, n)) {
+            std::cerr << "Error: Lost connection to drim server\n";
+            return 1;
+        }
+        if (tag == 'X') return (int)n;
+        std::string bytes(n, '\0');
+        if (!readAll(fd, &bytes[0], n)) {
+            std::cerr << "Error: Lost connection to drim server\n";
+            return 1;
+        }
+        writeAll(tag == 'E' ? STDERR_FILENO : STDOUT_FILENO, bytes.data(), bytes.size());
+    }
+}
+
+#else
+
+int runServer(const std::string&) {
+    std::cerr << "Error: --serve needs Unix domain sockets\n";
+    return 1;
+}
+
+int runClient(const std::string&, const std::string&) {
+    std::cerr << "Error: --client needs Unix domain sockets\n";
+    return 1;
+}
+
+#endif
@@ -0,0 +1,208 @@
+#include "../include/Tasks.h"
+#include "../include/Interpreter.h"
+#include "../include/Output.h"
+#include "../include/SampleProfiler.h"
+#include "../include/Signal.h"
+#include "../include/ThreadPool.h"
+#include <chrono>
+#include <iostream>
+
+// Index of the scheduler worker running on this thread (none for main)
+static const size_t NO_WORKER = (size_t)-1;
+static thread_local size_t homeWorker = NO_WORKER;
+
+TaskScheduler& TaskScheduler::instance() {
+    // Never destroyed: the workers sleep until the process exits
+    static TaskScheduler* scheduler = new TaskScheduler();
+    return *scheduler;
+}
+
+void TaskScheduler::start() {
+    std::call_once(started, [this] {
+        // Tasks may print from now on
+        OutputBuffer::enterConcurrent();
+        size_t count = ThreadPool::instance().configuredSize();
+        for (size_t id = 0; id < count; id++) workers.push_back(std::make_unique<Worker>());
+        for (size_t id = 0; id < count; id++) std::thread(&TaskScheduler::workerLoop, this, id).detach();
+    });
+}
+
+void TaskScheduler::spawn(const std::shared_ptr<Task>& task) {
+    start();
+    outstanding.fetch_add(1, std::memory_order_relaxed);
+    size_t target = homeWorker != NO_WORKER ? homeWorker : nextVictim.fetch_add(1) % workers.size();
+    {
+        std::lock_guard<std::mutex> guard(workers[target]->lock);
+        workers[target]->tasks.push_back(task);
+    }
+    {
+        std::lock_guard<std::mutex> guard(idleLock);
+        queued++;
+    }
+    idle.notify_one();
+}
+
+std::shared_ptr<Task> TaskScheduler::findWork(size_t home) {
+    size_t count = workers.size();
+    std::shared_ptr<Task> task;
+    if (home != NO_WORKER) {
+        Worker& own = *workers[home];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+    for (size_t k = 0; !task && k < count; k++) {
+        Worker& victim = *workers[(home == NO_WORKER ? k : home + 1 + k) % count];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+    if (task) {
+        std::lock_guard<std::mutex> guard(idleLock);
+        queued--;
+    }
+    return task;
+}
+
+// Runs the task unless another thread already claimed it. A task stays in
+// its deque after an await ran it inline, so stale entries are skipped here.
+void TaskScheduler::run(const std::shared_ptr<Task>& task) {
+    int expected = Task::QUEUED;
+    if (!task->state.compare_exchange_strong(expected, Task::RUNNING, std::memory_order_acq_rel)) return;
+
+    Value result = Interpreter::runTask(*task);
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->result = std::move(result);
+        task->state.store(Task::DONE, std::memory_order_release);
+        task->scope.reset();
+    }
+    task->finished.notify_all();
+
+    if (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> guard(idleLock);
+        drained.notify_all();
+    }
+}
+
+Value TaskScheduler::await(const std::shared_ptr<Task>& task) {
+    if (task->state.load(std::memory_order_acquire) != Task::DONE) {
+        // Not started yet: cheaper to run it here than to wait for a worker
+        run(task);
+        while (task->state.load(std::memory_order_acquire) != Task::DONE) {
+            if (auto other = findWork(homeWorker)) {
+                run(other);
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(task->lock);
+            task->finished.wait_for(guard, std::chrono::milliseconds(1),
+                                    [&] { return task->state.load(std::memory_order_acquire) == Task::DONE; });
+        }
+    }
+    std::lock_guard<std::mutex> guard(task->lock);
+    return task->result;
+}
+
+void TaskScheduler::drain() {
+    while (outstanding.load(std::memory_order_acquire) > 0) {
+        if (auto task = findWork(homeWorker)) {
+            run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(idleLock);
+        drained.wait_for(guard, std::chrono::milliseconds(1),
+                         [&] { return outstanding.load(std::memory_order_acquire) == 0; });
+    }
+}
+
+void TaskScheduler::workerLoop(size_t id) {
+    SampleProfiler::blockSignal();
+    homeWorker = id;
+    while (true) {
+        if (auto task = findWork(id)) {
+            run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(idleLock);
+        idle.wait(guard, [this] { return queued > 0; });
+    }
+}
+
+// Stacks, queues and maps, also inside arrays, are not thread-safe and so
+// cannot be handed to another task
+static bool holdsCollection(const Value& v) {
+    if (std::holds_alternative<std::shared_ptr<std::vector<Value>>>(v.data) ||
+        std::holds_alternative<std::shared_ptr<Map>>(v.data)) return true;
+    if (auto arr = std::get_if<Array>(&v.data)) {
+        for (size_t i = 0; i < arr->size(); i++) {
+            if (holdsCollection((*arr)[i])) return true;
+        }
+    }
+    return false;
+}
+
+Value Interpreter::spawnTask(const SpawnExpr& spawn) {
+    auto var = std::dynamic_pointer_cast<VariableExpr>(spawn.call->callee);
+    std::shared_ptr<FunctionStmt> func = scope->getFunc(var->name.lexeme);
+    if (!func) {
+        std::cerr << "Runtime Error: spawn needs a user function, '" << var->name.lexeme << "' is not one.\n";
+        drimExit(1);
+    }
+    if (spawn.call->arguments.size() != func->params.size()) {
+        std::cerr << "Runtime Error: Expected " << func->params.size() << " arguments but got "
+                  << spawn.call->arguments.size() << ".\n";
+        drimExit(1);
+    }
+
+    auto task = std::make_shared<Task>();
+    task->func = func;
+    task->hostCall = hostCall;
+    {
+        MemTag tag(MEM_SCOPES);
+        task->scope = std::make_shared<Scope>();
+    }
+    scope->collectFunctions(*task->scope);
+    for (size_t i = 0; i < func->params.size(); i++) {
+        Value arg = evaluate(spawn.call->arguments[i]);
+        if (holdsCollection(arg)) {
+            std::cerr << "Runtime Error: Cannot pass a stack, queue or map to spawn (argument '"
+                      << func->params[i].lexeme << "' of " << func->name.lexeme << ").\n";
+            drimExit(1);
+        }
+        task->scope->define(func->params[i].lexeme, std::move(arg));
+    }
+
+    if (throwsOnExit()) {
+        // --batch jobs run their tasks eagerly on their own thread
+        task->state.store(Task::RUNNING, std::memory_order_relaxed);
+        task->result = runTask(*task);
+        task->state.store(Task::DONE, std::memory_order_release);
+        return Value(task);
+    }
+
+    TaskScheduler::instance().spawn(task);
+    return Value(task);
+}
+
+Value Interpreter::runTask(Task& task) {
+    Interpreter child(task.scope, nullptr);
+    child.inTask = true;
+    child.hostCall = task.hostCall;
+    Tracer::Span traced(child.tracer, task.func->name.lexeme.c_str(), "task");
+    try {
+        child.interpret(task.func->body);
+    } catch (ReturnValue& rv) {
+        return std::move(rv.value);
+    } catch (BreakSignal&) {
+        std::cerr << "Runtime Error: stopdrim outside a loop in spawned " << task.func->name.lexeme << "\n";
+        drimExit(1);
+    } catch (ContinueSignal&) {
+        std::cerr << "Runtime Error: drimagain outside a loop in spawned " << task.func->name.lexeme << "\n";
+        drimExit(1);
+    }
+    return 0LL;
+}
@@ -0,0 +1,76 @@
+#include "../include/ThreadPool.h"
+#include "../include/SampleProfiler.h"
+
+ThreadPool& ThreadPool::instance() {
+    // Never destroyed: the workers sleep until the process exits
+    static ThreadPool* pool = new ThreadPool();
+    return *pool;
+}
+
+void ThreadPool::setThreads(size_t count) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!started) wanted = count;
+}
+
+size_t ThreadPool::size() {
+    std::lock_guard<std::mutex> guard(lock);
+    start();
+    return threads.size() + 1;
+}
+
+size_t ThreadPool::configuredSize() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (started) return threads.size() + 1;
+    size_t count = wanted ? wanted : std::thread::hardware_concurrency();
+    return count ? count : 1;
+}
+
+// Caller holds the lock
+void ThreadPool::start() {
+    if (started) return;
+    started = true;
+    size_t count = wanted ? wanted : std::thread::hardware_concurrency();
+    if (count == 0) count = 1;
+    for (size_t id = 1; id < count; id++) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, id);
+        threads.back().detach();
+    }
+}
+
+void ThreadPool::runOnAll(const std::function<void(size_t)>& work) {
+    std::unique_lock<std::mutex> guard(lock);
+    start();
+    if (busy || threads.empty()) {
+        guard.unlock();
+        work(0);
+        return;
+    }
+    busy = true;
+    job = &work;
+    remaining = threads.size();
+    generation++;
+    guard.unlock();
+    wake.notify_all();
+
+    work(0);
+
+    guard.lock();
+    done.wait(guard, [this] { return remaining == 0; });
+    job = nullptr;
+    busy = false;
+}
+
+void ThreadPool::workerLoop(size_t id) {
+    SampleProfiler::blockSignal();
+    unsigned long long seen = 0;
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [&] { return generation != seen; });
+        seen = generation;
+        const std::function<void(size_t)>* work = job;
+        guard.unlock();
+        (*work)(id);
+        guard.lock();
+        if (--remaining == 0) done.notify_one();
+    }
+}
@@ -0,0 +1,109 @@
+#include "../include/Tracer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+Tracer* Tracer::current = nullptr;
+
+namespace {
+std::atomic<uint32_t> nextThread{0};
+
+uint64_t steadyNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void writeEscaped(std::ostream& out, const char* text) {
+    for (; *text; text++) {
+        char c = *text;
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if ((unsigned char)c >= 0x20) out << c;
+    }
+}
+}
+
+Tracer::Tracer(const std::string& path) : jsonPath(path) {
+    events = new Event[CAPACITY];
+    startNs = steadyNs();
+    startTicks = ticks();
+}
+
+// Lives until exit; finish() runs from main, or from atexit after exit(1)
+Tracer& Tracer::start(const std::string& jsonPath) {
+    current = new Tracer(jsonPath);
+    threadId(); // the caller is thread 0
+    std::atexit([] { current->finish(); });
+    return *current;
+}
+
+// The main thread is 0, other threads are numbered as they first trace
+uint32_t Tracer::threadId() {
+    thread_local uint32_t id = nextThread.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void Tracer::finish() {
+    if (finished.exchange(true)) return;
+    uint64_t endTicks = ticks();
+    uint64_t endNs = steadyNs();
+    double nsPerTick = endTicks > startTicks ? (double)(endNs - startNs) / (double)(endTicks - startTicks) : 1.0;
+
+    uint64_t total = next.load();
+    uint64_t first = total > CAPACITY ? total - CAPACITY : 0;
+
+    std::ofstream json(jsonPath);
+    if (!json.is_open()) {
+        std::cerr << "Warning: could not write trace to '" << jsonPath << "'\n";
+        return;
+    }
+
+    // Per thread, the begins not yet ended; ends whose begin was overwritten
+    // are dropped, and spans still open at exit are closed at the end
+    std::vector<std::vector<const Event*>> open;
+    char ts[32];
+    auto write = [&](const char* name, const char* category, char phase, uint64_t at, uint32_t thread) {
+        std::snprintf(ts, sizeof(ts), "%.3f", (double)(at - startTicks) * nsPerTick / 1000.0);
+        json << ",\n{\"name\":\"";
+        writeEscaped(json, name);
+        json << "\",\"cat\":\"" << category << "\",\"ph\":\"" << phase << "\",\"ts\":" << ts
+             << ",\"pid\":1,\"tid\":" << thread << "}";
+    };
+
+    json << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+         << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"drim\"}}";
+    uint64_t written = 0;
+    for (uint64_t i = first; i < total; i++) {
+        const Event& e = events[i & (CAPACITY - 1)];
+        if (e.thread >= open.size()) open.resize(e.thread + 1);
+        std::vector<const Event*>& stack = open[e.thread];
+        if (e.phase == 'B') {
+            stack.push_back(&e);
+        } else {
+            if (stack.empty()) continue;
+            stack.pop_back();
+        }
+        write(e.name, e.category, e.phase, e.ticks, e.thread);
+        written++;
+    }
+    for (uint32_t thread = 0; thread < open.size(); thread++) {
+        while (!open[thread].empty()) {
+            const Event* e = open[thread].back();
+            open[thread].pop_back();
+            write(e->name, e->category, 'E', endTicks, thread);
+            written++;
+        }
+        json << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+             << ",\"args\":{\"name\":\"" << (thread == 0 ? "main" : "thread ") ;
+        if (thread) json << thread;
+        json << "\"}}";
+    }
+    json << "\n]}\n";
+
+    std::cout.flush();
+    if (total > CAPACITY) {
+        std::cerr << "Warning: trace buffer full, the oldest " << (total - CAPACITY) << " events were dropped\n";
+    }
+    std::cerr << "Trace written to " << jsonPath << " (" << written << " events)\n";
+}